@@ -1,184 +1,261 @@
-#include <fstream>
-#include <list>
+#include <algorithm>
+#include <cmath>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <numeric>
 #include <optional>
 #include <regex>
-#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 
+#include "arena.h"
+#include "mappedfile.h"
 #include "Object3D.h"
+#include "threadpool.h"
+#include "trianglesoa.h"
 
-using std::ifstream;
 using std::regex;
-using std::stringstream;
 
-float bytesToFloat(unsigned char* n) {
-	float* f = reinterpret_cast<float*>(n);
-	return *f;
-}
-
-Vector3d bytesToVector3d(unsigned char bytes[12]) {
-	return { bytesToFloat(bytes), bytesToFloat(bytes + 4), bytesToFloat(bytes + 8) };
-}
-
-Triangle3d readBinaryFacet(ifstream& file) {
-	Triangle3d triangle;
-
-	// Read normal 3*4 byte little-endian float
-	constexpr int buf_size = 12;
-	unsigned char buffer[buf_size];
-	file.read((char*)buffer, buf_size);
-	triangle.normal = bytesToVector3d(buffer);
-
-	// Read 3 vectors 3*3*4 byte little-endian float
-	for (unsigned int i = 0; i < 3; i++)
+void readBinaryFacets(const char* facets, size_t count, Triangle3d* triangles) {
+	// Each facet is a normal and 3 vertices as 12 4-byte little-endian floats, followed by a 2-byte attribute count.
+	// Triangle3d has the same layout as the 12 floats, so each facet is a single 48-byte copy.
+	static_assert(sizeof(Triangle3d) == 12 * sizeof(float), "Triangle3d must be 12 packed floats");
+	static_assert(std::is_trivially_copyable_v<Triangle3d>, "Triangle3d must be trivially copyable");
+	constexpr size_t facetSize = 50;
+	for (size_t i = 0; i < count; i++)
 	{
-		file.read((char*)buffer, buf_size);
-		triangle.vertices[i] = bytesToVector3d(buffer);
+		std::memcpy(triangles + i, facets + i * facetSize, sizeof(Triangle3d));
 	}
-
-	// Read attribute count 2 byte. Should be zero
-	char attribute_size[2];
-	file.read(attribute_size, 2);
-	//if (attribute_size[0] | attribute_size[1]) {
-	//	std::cerr << (unsigned int)attribute_size[0] << " " << (unsigned int)attribute_size[1] << std::endl;
-	//	//throw std::runtime_error("Attribute count must be zero");
-	//}
-
-	return triangle;
 }
 
 void Object3D::fromBinaryFile(string filename) {
-	ifstream file(filename, std::ios::binary | std::ios::in);
-	if (!file) {
-		throw std::runtime_error("Could not open file " + filename);
-	}
+	MappedFile file(filename);
 
-	// Read header and ignore
-	char header[80];
-	file.read(header, 80);
+	// 80 byte header which is ignored, followed by the number of facets
+	constexpr size_t headerSize = 84, facetSize = 50;
+	if (file.size() < headerSize) {
+		throw std::runtime_error("File is too small to be binary STL");
+	}
+	const unsigned char* size_bytes = reinterpret_cast<const unsigned char*>(file.data() + 80);
 
 	// Read size, little endian
-	unsigned char size_bytes[4];
-	file.read((char*)size_bytes, 4);
+	size_t size = static_cast<size_t>(size_bytes[3]) << 24 | size_bytes[2] << 16 | size_bytes[1] << 8 | size_bytes[0];
 
-	unsigned int size = size_bytes[3] * 256 * 256 * 256 + size_bytes[2] * 256 * 256 + size_bytes[1] * 256 + size_bytes[0];
+	if (file.size() < headerSize + facetSize * size) {
+		throw std::runtime_error("Size mismatch, header says " + std::to_string(size) + " facets but file only has room for "
+			+ std::to_string((file.size() - headerSize) / facetSize));
+	}
 
-	// Read size number of triangles
-	for (unsigned int i = 0; i < size; i++)
-	{
-		this->triangles.push_back(readBinaryFacet(file));
-	}
-
-	//// Should be no more data
-	//if (file) {
-	//	vector<unsigned char> data;
-	//	char byte[1];
-	//	while (file.read(byte, 1)) {
-	//		data.push_back(byte[0]);
-	//	}
-	//	throw std::runtime_error("Size mismatch");
-	//}
+	std::vector<Triangle3d> triangles(size);
+	readBinaryFacets(file.data() + headerSize, size, triangles.data());
+	this->mesh.add(triangles);
 }
 
-Triangle3d readASCIIFacet(ifstream& file) {
-	regex normal("^ *normal .*");
-	regex loopstart("^ *outer loop$");
-	regex vertexstart("^ *vertex .*");
-	regex loopend("^ *endloop$");
-	regex facetend("^ *endfacet$");
-
-	string line;
+class ASCIIReader {
+	// Splits part of a buffer into whitespace separated tokens.
+	// Line numbers for errors are counted from origin, the start of the file.
+public:
+	ASCIIReader(const char* origin, const char* begin, const char* end)
+		: origin{ origin }, position{ begin }, token{ begin }, end{ end } {}
 
-	// Read facet start
-	if (!getline(file, line)) {
-		throw std::runtime_error("Facet normal not found");
-	}
-	if (!regex_match(line.begin(), line.end(), normal)) {
-		throw std::runtime_error("Expected facet normal");
+	bool next(std::string_view& token) {
+		// Returns false at end of buffer
+		while (position != end && isWhitespace(*position)) {
+			position++;
+		}
+		this->token = position;
+		while (position != end && !isWhitespace(*position)) {
+			position++;
+		}
+		token = std::string_view(this->token, position - this->token);
+		return !token.empty();
 	}
-	string junk;
-	stringstream ss(line);
-	ss >> junk; // Remove "normal"
-	Triangle3d triangle;
-	ss >> triangle.normal;
 
-	// Read loop start
-	if (!getline(file, line)) {
-		throw std::runtime_error("Loop not found");
-	}
-	if (!regex_match(line.begin(), line.end(), loopstart)) {
-		throw std::runtime_error("Expected loop");
+	void expect(std::string_view keyword, const string& expected) {
+		std::string_view token;
+		if (!next(token) || token != keyword) {
+			error(expected);
+		}
 	}
 
-	// Read vertices
-	for (int i = 0; i < 3; i++)
-	{
-		if (!getline(file, line)) {
-			throw std::runtime_error("Vertex not found");
+	float readFloat(const string& expected) {
+		std::string_view token;
+		if (!next(token)) {
+			error(expected);
+		}
+		// from_chars does not accept a leading plus sign
+		if (token.front() == '+') {
+			token.remove_prefix(1);
 		}
-		if (!regex_match(line.begin(), line.end(), vertexstart)) {
-			throw std::runtime_error("Expected vertex");
+		float value;
+		auto [end, code] = std::from_chars(token.data(), token.data() + token.size(), value);
+		if (code != std::errc() || end != token.data() + token.size()) {
+			error(expected);
 		}
-		ss = stringstream(line);
-		ss >> junk; // Remove "vertex"
-		ss >> triangle.vertices[i];
+		return value;
 	}
 
-	// Read loop end
-	if (!getline(file, line)) {
-		throw std::runtime_error("Loop end not found");
+	Vector3d readVector(const string& expected) {
+		Vector3d vector;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			vector[i] = readFloat(expected);
+		}
+		return vector;
 	}
-	if (!regex_match(line.begin(), line.end(), loopend)) {
-		throw std::runtime_error("Expected loop end");
+
+	void skipLine() {
+		while (position != end && *position != '\n') {
+			position++;
+		}
 	}
 
-	// Read facet end
-	if (!getline(file, line)) {
-		throw std::runtime_error("Facet end not found");
+	const char* current() const {
+		return position;
 	}
-	if (!regex_match(line.begin(), line.end(), facetend)) {
-		throw std::runtime_error("Expected facet end");
+
+	static bool isWhitespace(char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
 	}
 
-	return triangle;
-}
+	[[noreturn]] void error(const string& expected) const {
+		// Only counted when failing so parsing does not have to track lines
+		size_t line = 1 + std::count(origin, token, '\n');
+		throw std::runtime_error("Line " + std::to_string(line) + ": Expected " + expected);
+	}
+private:
+	const char* origin;
+	const char* position;
+	const char* token; // Start of last token
+	const char* end;
+};
 
-void Object3D::fromASCIIFile(string filename) {
-	regex solidstart("^solid \\S*");
-	regex solidend("endsolid");
-	regex facetstart("facet");
+Triangle3d readASCIIFacet(ASCIIReader& reader) {
+	// Reads the rest of a facet after the "facet" keyword
+	Triangle3d triangle;
+	reader.expect("normal", "facet normal");
+	triangle.normal = reader.readVector("facet normal");
 
-	ifstream file(filename);
-	if (!file) {
-		throw std::runtime_error("Could not open file " + filename);
-	}
+	reader.expect("outer", "loop");
+	reader.expect("loop", "loop");
 
-	string line;
-	if (!getline(file, line))
+	for (unsigned int i = 0; i < 3; i++)
 	{
-		throw std::runtime_error("File does not include a solid");
+		reader.expect("vertex", "vertex");
+		triangle.vertices[i] = reader.readVector("vertex");
 	}
 
-	if (!regex_match(line.begin(), line.end(), solidstart))
-	{
-		throw std::runtime_error("First line must start with \"solid\".");
+	reader.expect("endloop", "loop end");
+	reader.expect("endfacet", "facet end");
+	return triangle;
+}
+
+void readASCIIFacets(ASCIIReader& reader, std::vector<Triangle3d>& triangles, bool last) {
+	// Reads facets until the end of the reader, the last part of the file must end with "endsolid"
+	std::string_view token;
+	while (reader.next(token)) {
+		if (token == "facet") {
+			triangles.push_back(readASCIIFacet(reader));
+		}
+		else if (last && token == "endsolid") {
+			return;
+		}
+		else {
+			reader.error("facet or endsolid");
+		}
 	}
+	if (last) {
+		reader.error("facet or endsolid");
+	}
+}
 
+const char* afterEndSolid(const char* begin, const char* end) {
+	// End of the first "endsolid" keyword in [begin, end), or end if there is none.
+	// Reading stops there, so whatever follows, like another solid, is not split into parts.
+	std::string_view text(begin, end - begin);
+	constexpr std::string_view keyword = "endsolid";
+	size_t position = 0;
+	while ((position = text.find(keyword, position)) != std::string_view::npos) {
+		size_t after = position + keyword.size();
+		bool alone = (position == 0 || ASCIIReader::isWhitespace(text[position - 1]))
+			&& (after == text.size() || ASCIIReader::isWhitespace(text[after]));
+		if (alone) {
+			return begin + after;
+		}
+		position++;
+	}
+	return end;
+}
 
-	while (true) {
-		file >> line;
-		if (regex_match(line.begin(), line.end(), facetstart)) {
-			this->triangles.push_back(readASCIIFacet(file));
+std::vector<const char*> facetBoundaries(const char* begin, const char* end, size_t parts) {
+	// Splits [begin, end) into at most parts pieces that each start at a "facet" keyword
+	std::string_view text(begin, end - begin);
+	std::vector<const char*> boundaries{ begin };
+	for (size_t part = 1; part < parts; part++)
+	{
+		size_t position = std::max(text.size() * part / parts, static_cast<size_t>(boundaries.back() - begin) + 1);
+		while ((position = text.find("facet", position)) != std::string_view::npos) {
+			// Skip "endfacet" and anything else that is not the keyword on its own
+			bool keyword = position > 0 && ASCIIReader::isWhitespace(text[position - 1])
+				&& position + 5 < text.size() && ASCIIReader::isWhitespace(text[position + 5]);
+			if (keyword) {
+				break;
+			}
+			position++;
 		}
-		else if (regex_match(line.begin(), line.end(), solidend)) {
+		if (position == std::string_view::npos) {
 			break;
 		}
-		else {
-			throw std::runtime_error("Invalid syntax");
+		boundaries.push_back(begin + position);
+	}
+	boundaries.push_back(end);
+	return boundaries;
+}
+
+void Object3D::fromASCIIFile(string filename, unsigned int threads) {
+	MappedFile file(filename);
+	const char* begin = file.data();
+	const char* end = file.data() + file.size();
+	ASCIIReader reader(begin, begin, end);
+
+	// First line is "solid" followed by an optional name
+	reader.expect("solid", "\"solid\" at start of file");
+	reader.skipLine();
+
+	std::vector<Triangle3d> triangles;
+	if (threads == 1) {
+		readASCIIFacets(reader, triangles, true);
+		this->mesh.add(triangles);
+		return;
+	}
+
+	// Split the facets into parts that are parsed on their own and joined in file order,
+	// so the triangle order does not depend on the number of threads. Like the serial read, they stop at the first "endsolid".
+	PoolHandle pool(threads);
+	std::vector<const char*> boundaries = facetBoundaries(reader.current(), afterEndSolid(reader.current(), end), pool.size() * 4);
+	std::vector<std::vector<Triangle3d>> parts(boundaries.size() - 1);
+	pool.parallelFor(parts.size(), [&](size_t first, size_t last) {
+		for (size_t part = first; part < last; part++)
+		{
+			ASCIIReader partReader(begin, boundaries[part], boundaries[part + 1]);
+			readASCIIFacets(partReader, parts[part], part + 1 == parts.size());
 		}
+		});
+
+	size_t count = 0;
+	for (const auto& part : parts) {
+		count += part.size();
+	}
+	triangles.reserve(count);
+	for (const auto& part : parts) {
+		triangles.insert(triangles.end(), part.cbegin(), part.cend());
 	}
+	this->mesh.add(triangles);
 }
 
-void Object3D::fromFile(string filename, bool binary)
+void Object3D::fromFile(string filename, bool binary, unsigned int threads)
 {
 	regex fileExtension(".+\\.stl$");
 	if (!regex_match(filename.begin(), filename.end(), fileExtension)) {
@@ -191,9 +268,15 @@ void Object3D::fromFile(string filename, bool binary)
 	}
 	else
 	{
-		fromASCIIFile(filename);
+		fromASCIIFile(filename, threads);
+	}
+	this->soa = TriangleSoA(this->mesh);
+	this->bvh = BoundingVolumeHierarchy(this->mesh);
+	this->extentIndex.reset();
+	this->size = 0.0f;
+	for (const auto& vertex : this->mesh.vertices) {
+		this->size = std::max(this->size, vertex.length());
 	}
-
 }
 
 Line get_triangle_edge(const Triangle3d& triangle, unsigned int index)
@@ -211,51 +294,128 @@ std::optional<std::pair<float, Vector2d>>  angleAndVertexIfClose(const Edge2d& e
 	return {};
 }
 
-std::optional<Vector2d> extractClose(std::list<Edge2d>& edges, const Vector2d& vertex, const Vector2d& direction) {
-	Vector2d minVertex;
-	auto minIt = edges.end();
-	float minAngle = INFINITY;
-	for (auto it = edges.begin(), end = edges.end(); it != end; ++it) {
-		auto angleAndVertex = angleAndVertexIfClose(*it, vertex, direction);
-		if (!angleAndVertex) {
-			// Edge not close, skip
-			continue;
+class EndpointIndex {
+	// Edges whose endpoints are hashed into a grid, so the edges touching a vertex
+	// are found without scanning every edge
+public:
+	explicit EndpointIndex(std::pmr::vector<Edge2d> edges)
+		: edges{ std::move(edges) }, removed(this->edges.size(), this->edges.get_allocator()), remaining{ this->edges.size() },
+		first(this->edges.get_allocator()), next(this->edges.get_allocator())
+	{
+		first.reserve(2 * this->edges.size());
+		next.reserve(2 * this->edges.size());
+		for (uint32_t endpoint = 0; endpoint < 2 * this->edges.size(); endpoint++)
+		{
+			const Edge2d& edge = this->edges[endpoint / 2];
+			auto [it, inserted] = first.try_emplace(cellOf(endpoint % 2 ? edge.end : edge.start), endpoint);
+			next.push_back(inserted ? none : it->second);
+			it->second = endpoint;
 		}
+	}
 
-		auto [angle, vertex] = *angleAndVertex;
+	bool empty() const {
+		return remaining == 0;
+	}
 
-		// Find minimum
-		if (angle < minAngle) {
-			minVertex = vertex;
-			minIt = it;
-			minAngle = angle;
+	const Edge2d& outermost() const {
+		// Edge furthest in one direction, to ensure to be on outermost perimeter
+		size_t max = edges.size();
+		for (size_t i = 0; i < edges.size(); i++)
+		{
+			if (!removed[i] && (max == edges.size() || std::max(edges[max].start[0], edges[max].end[0]) < std::max(edges[i].start[0], edges[i].end[0]))) {
+				max = i;
+			}
 		}
+		return edges[max];
 	}
 
-	if (minIt != edges.end())
-	{
-		edges.erase(minIt);
-		return minVertex;
+	std::optional<Vector2d> extractClose(const Vector2d& vertex, const Vector2d& direction) {
+		// Removes the edge touching vertex that turns least from direction and returns its other end.
+		// Ties go to the first edge, as when scanning all edges in order.
+		Vector2d minVertex;
+		size_t minEdge = edges.size();
+		float minAngle = INFINITY;
+
+		// Close endpoints are in the cell of vertex or the neighbours on the sides vertex is closest to
+		int64_t step[2];
+		for (unsigned int axis = 0; axis < 2; axis++)
+		{
+			float scaled = vertex[axis] / cellSize;
+			step[axis] = scaled - std::floor(scaled) < 0.5f ? -1 : 1;
+		}
+		auto [x, y] = cellOf(vertex);
+		for (unsigned int neighbour = 0; neighbour < 4; neighbour++)
+		{
+			auto it = first.find({ x + (neighbour & 1 ? step[0] : 0), y + (neighbour & 2 ? step[1] : 0) });
+			if (it == first.end()) {
+				continue;
+			}
+			for (uint32_t endpoint = it->second; endpoint != none; endpoint = next[endpoint]) {
+				size_t edge = endpoint / 2;
+				if (removed[edge]) {
+					continue;
+				}
+				auto angleAndVertex = angleAndVertexIfClose(edges[edge], vertex, direction);
+				if (!angleAndVertex) {
+					// Edge not close, skip
+					continue;
+				}
+
+				auto [angle, other] = *angleAndVertex;
+
+				// Find minimum
+				if (angle < minAngle || (angle == minAngle && edge < minEdge)) {
+					minVertex = other;
+					minEdge = edge;
+					minAngle = angle;
+				}
+			}
+		}
+
+		if (minEdge != edges.size())
+		{
+			removed[minEdge] = true;
+			remaining--;
+			return minVertex;
+		}
+		return {};
 	}
-	return {};
-}
+private:
+	struct CellHash {
+		size_t operator()(const std::pair<int64_t, int64_t>& cell) const {
+			return std::hash<int64_t>()(cell.first * 73856093 ^ cell.second * 19349663);
+		}
+	};
+	static constexpr float cellSize = 2 * FLOATERROR;
+	static constexpr uint32_t none = UINT32_MAX;
+
+	std::pmr::vector<Edge2d> edges;
+	std::pmr::vector<bool> removed;
+	size_t remaining;
+	// Endpoint 2 * i is the start of edge i, 2 * i + 1 the end
+	std::pmr::unordered_map<std::pair<int64_t, int64_t>, uint32_t, CellHash> first; // First endpoint in each cell
+	std::pmr::vector<uint32_t> next; // Next endpoint in the same cell, or none
+
+	static std::pair<int64_t, int64_t> cellOf(const Vector2d& vertex) {
+		return { static_cast<int64_t>(std::floor(vertex[0] / cellSize)), static_cast<int64_t>(std::floor(vertex[1] / cellSize)) };
+	}
+};
 
-std::optional<SimplePolygon> linkEdges(std::list<Edge2d>& edges) {
+std::optional<SimplePolygon> linkEdges(EndpointIndex& edges) {
 	// Removes elements from edges and combines them into a simple polygon
-	auto max = std::max_element(edges.begin(), edges.end(),
-		[](const Edge2d& lhs, const Edge2d& rhs) {
-			// Find edge furthest in one direction to ensure to be on outermost perimeter
-			return std::max(lhs.start[0], lhs.end[0]) < std::max(rhs.start[0], rhs.end[0]);
-		});
+	if (edges.empty()) {
+		return {};
+	}
+	const Edge2d& max = edges.outermost();
 
 	SimplePolygon polygon;
-	Vector2d start = max->start[0] > max->end[0] ? max->start : max->end;
+	Vector2d start = max.start[0] > max.end[0] ? max.start : max.end;
 	Vector2d vertex = start, prev;
 	Vector2d direction{ 1.0f, 0.0f };
 	do {
 		polygon.vertices.push_back(vertex);
 
-		auto extraction = extractClose(edges, vertex, direction);
+		auto extraction = edges.extractClose(vertex, direction);
 		if (!extraction) {
 			return {};
 		}
@@ -268,24 +428,221 @@ std::optional<SimplePolygon> linkEdges(std::list<Edge2d>& edges) {
 
 Polygon Object3D::intersect(const Plane& plane) const
 {
-	std::vector<Triangle3d> intersectingTriangles = intersects(this->triangles, plane);
-	if (intersectingTriangles.empty()) {
-		throw std::runtime_error("Plane does not intersect");
+	return intersect(plane, candidates(plane));
+}
+
+FixedPolygon Object3D::intersect(const Plane& plane, const FixedPointGrid& grid) const
+{
+	return intersect(plane, grid, candidates(plane));
+}
+
+std::vector<unsigned int> Object3D::candidates(const Plane& plane) const
+{
+	// Only faces whose extent along the normal reaches the plane can intersect it.
+	// The interval tree is the quickest way to find them, but has to be built for each direction, so it is only
+	// built once a direction is asked for twice in a row. Other planes are looked up in the bounding volume hierarchy.
+	Vector3d direction = plane.normal.normalized();
+	std::shared_ptr<const ExtentIndex> index = std::atomic_load(&this->extentIndex);
+	if (!index || !index->direction.isClose(direction)) {
+		std::atomic_store(&this->extentIndex, std::make_shared<const ExtentIndex>(ExtentIndex{ direction, std::nullopt }));
+		return this->bvh.intersecting(this->mesh, plane, tolerance(plane.normal));
+	}
+	if (!index->tree) {
+		// Threads calling intersect() at once share the index through atomic loads and stores,
+		// at worst several of them build the same tree
+		index = std::make_shared<const ExtentIndex>(ExtentIndex{ direction, IntervalTree(this->extents(direction)) });
+		std::atomic_store(&this->extentIndex, index);
+	}
+	float distance = plane.point.dot(plane.normal) / plane.normal.length();
+	return index->tree->stab(distance, tolerance(plane.normal));
+}
+
+std::vector<Polygon> Object3D::intersect(const std::vector<Plane>& planes, unsigned int threads) const
+{
+	// One traversal of the bounding volume hierarchy finds the candidates of every plane
+	float widest = 0.0f;
+	for (const auto& plane : planes) {
+		widest = std::max(widest, tolerance(plane.normal));
+	}
+	std::vector<std::vector<unsigned int>> candidates = this->bvh.intersecting(this->mesh, planes, widest);
+	std::vector<Polygon> result(planes.size());
+	if (threads == 1) {
+		for (size_t i = 0; i < planes.size(); i++) {
+			result[i] = intersect(planes[i], candidates[i]);
+		}
+		return result;
+	}
+	PoolHandle pool(threads);
+	pool.parallelFor(planes.size(), [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			result[i] = intersect(planes[i], candidates[i]);
+		}
+		}, 1);
+	return result;
+}
+
+float Object3D::tolerance(const Vector3d& normal) const
+{
+	// Widens candidate lookups, generous next to the rounding error of distances along the normal and tiny next to a layer.
+	// Faces closer than FLOATERROR count as touching the plane, measured along the unnormalized normal.
+	return this->size * 1e-5f + 2 * FLOATERROR / normal.length();
+}
+
+Polygon Object3D::intersect(const Plane& plane, const std::vector<unsigned int>& candidates) const
+{
+	// Candidates are indices into mesh faces in ascending order, and may include
+	// triangles that do not intersect the plane.
+
+	// Nearly every job slices along z, where projecting only drops z
+	if (isAxisAligned(plane)) {
+		return intersect(plane, AxisAlignedFrame(plane), candidates);
+	}
+	return intersect(plane, GeneralFrame(plane), candidates);
+}
+
+template<typename Frame>
+Polygon Object3D::intersect(const Plane& plane, const Frame& frame, const std::vector<unsigned int>& candidates) const
+{
+	// Scratch memory for the layer comes from this thread's arena, left over from the previous layer
+	Arena::local().reset();
+	if (this->mesh.closed()) {
+		auto polygon = traceContours(plane, frame, candidates);
+		if (polygon) {
+			return std::move(*polygon);
+		}
+	}
+	return linkContours(plane, frame, candidates);
+}
+
+template<typename Frame>
+std::optional<Polygon> Object3D::traceContours(const Plane& plane, const Frame& frame, const std::vector<unsigned int>& candidates) const
+{
+	// Follows the cross section from face to face through shared edges.
+	// Vertices within FLOATERROR of the plane count as below it, so each crossing face has exactly one edge
+	// going up through the plane and one going down, and the next face is the neighbour across the down edge.
+	// Returns nothing if the section cannot be traced, or no face crosses the plane.
+	struct Crossing {
+		unsigned int face;
+		unsigned int down; // Edge where the section leaves the face
+		Vector3d point; // Where the section enters the face
+	};
+	Arena& arena = Arena::local();
+	PlaneSides sides(&arena);
+	classify(this->soa, plane, candidates, sides);
+
+	std::pmr::vector<Crossing> crossings(&arena);
+	std::pmr::unordered_map<unsigned int, size_t> crossingOf(&arena); // Face to index in crossings
+	for (size_t candidate = 0; candidate < candidates.size(); candidate++)
+	{
+		unsigned int index = candidates[candidate];
+		const auto& face = this->mesh.faces[index];
+		std::array<float, 3> distances;
+		std::array<bool, 3> above;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			distances[i] = sides.distances[i][candidate];
+			above[i] = sides.sides[i][candidate] == 1;
+		}
+		if (above[0] == above[1] && above[1] == above[2]) {
+			continue;
+		}
+
+		Crossing crossing{ index, 0, Vector3d{ 0, 0, 0 } };
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			unsigned int j = (i + 1) % 3;
+			if (!above[i] && above[j]) {
+				const Vector3d& start = this->mesh.vertices[face[i]];
+				const Vector3d& end = this->mesh.vertices[face[j]];
+				float t = saturate(distances[i] / (distances[i] - distances[j]), 0.0f, 1.0f);
+				crossing.point = start + (end - start) * t;
+			}
+			else if (above[i] && !above[j]) {
+				crossing.down = i;
+			}
+		}
+		crossingOf.emplace(index, crossings.size());
+		crossings.push_back(crossing);
 	}
+	if (crossings.empty()) {
+		return {};
+	}
+
+	Polygon polygon;
+	std::pmr::vector<bool> visited(crossings.size(), false, &arena);
+	for (size_t first = 0; first < crossings.size(); first++)
+	{
+		if (visited[first]) {
+			continue;
+		}
+		// Traced in the arena, only the finished path is copied to the heap
+		std::pmr::vector<Vector2d> path(&arena);
+		size_t current = first;
+		do {
+			visited[current] = true;
+			Vector2d vertex = frame.project(crossings[current].point);
+			// Sections through a mesh vertex enter several faces at the same point
+			if (path.empty() || !vertex.isClose(path.back())) {
+				path.push_back(vertex);
+			}
+
+			auto next = crossingOf.find(this->mesh.neighbours[crossings[current].face][crossings[current].down]);
+			if (next == crossingOf.end()) {
+				return {};
+			}
+			current = next->second;
+			if (visited[current] && current != first) {
+				return {};
+			}
+		} while (current != first);
+
+		if (path.size() > 1 && path.back().isClose(path.front())) {
+			path.pop_back();
+		}
+		// Sections that only touch the plane at a vertex collapse to a point
+		if (path.size() >= 3) {
+			// Traced clockwise around the outside of an outward facing mesh, reverse so outer paths are counterclockwise
+			std::reverse(path.begin(), path.end());
+			polygon.paths.push_back(SimplePolygon{ std::vector<Vector2d>(path.cbegin(), path.cend()) });
+		}
+	}
+	// Put the path with the rightmost vertex first, as linkContours does
+	rightmostFirst(polygon.paths);
+	return polygon;
+}
+
+template<typename Frame>
+Polygon Object3D::linkContours(const Plane& plane, const Frame& frame, const std::vector<unsigned int>& candidates) const
+{
+	// Matches the endpoints of the edges where each triangle crosses the plane
+
+	Arena& arena = Arena::local();
+	PlaneSides sides(&arena);
+	classify(this->soa, plane, candidates, sides);
 
 	// Find intersections between plane and triangles.
-	std::list<Edge3d> edges3d;
-	for (const Triangle3d& triangle : intersectingTriangles)
+	std::pmr::vector<Edge3d> edges3d(&arena);
+	unsigned int intersecting = 0;
+	for (size_t candidate = 0; candidate < candidates.size(); candidate++)
 	{
-		std::vector<Edge3d> edges = intersection(plane, triangle);
-		edges3d.insert(edges3d.end(), edges.cbegin(), edges.cend());
+		// Skip triangles with all vertices on the same side of the plane, as aboveOrBelow
+		auto& distances = sides.distances;
+		if ((distances[0][candidate] > 0 && distances[1][candidate] > 0 && distances[2][candidate] > 0)
+			|| (distances[0][candidate] < 0 && distances[1][candidate] < 0 && distances[2][candidate] < 0)) {
+			continue;
+		}
+		intersecting++;
+		intersection(plane, this->mesh.triangle(candidates[candidate]), edges3d);
+	}
+	if (intersecting == 0) {
+		throw std::runtime_error("Plane does not intersect");
 	}
 
 	// Project edges into plane
-	std::list<Edge2d> projected(edges3d.size());
+	std::pmr::vector<Edge2d> projected(edges3d.size(), &arena);
 	std::transform(edges3d.cbegin(), edges3d.cend(), projected.begin(),
-		[&plane](const Edge3d edge) {
-			return project(plane, edge);
+		[&frame](const Edge3d edge) {
+			return project(frame, edge);
 		});
 
 	// Remove edges from triangles in plane
@@ -297,13 +654,14 @@ Polygon Object3D::intersect(const Plane& plane) const
 
 	// Link edges
 	Polygon intersection;
-	auto poly = linkEdges(projected);
+	EndpointIndex index(std::move(projected));
+	auto poly = linkEdges(index);
 	if (!poly) {
 		throw std::runtime_error("Could not link edges");
 	}
 	intersection.paths.push_back(*poly);
-	while (!projected.empty()) {
-		poly = linkEdges(projected);
+	while (!index.empty()) {
+		poly = linkEdges(index);
 		if (!poly) {
 			break;
 		}
@@ -313,6 +671,194 @@ Polygon Object3D::intersect(const Plane& plane) const
 	return intersection;
 }
 
+Polygon Object3D::intersect(const Plane& plane, ContourTracker& tracker, const Candidates& candidates) const
+{
+	// Layers between mesh vertices only move the points along the edges crossing the plane,
+	// the faces are only looked at again when the loops cannot be carried over
+	if (tracker.advance(plane) || tracker.trace(plane, candidates())) {
+		if (isAxisAligned(plane)) {
+			return tracker.polygon(AxisAlignedFrame(plane));
+		}
+		return tracker.polygon(GeneralFrame(plane));
+	}
+	return intersect(plane, candidates());
+}
+
+FixedPolygon Object3D::intersect(const Plane& plane, const FixedPointGrid& grid, const std::vector<unsigned int>& candidates) const
+{
+	Arena::local().reset();
+	if (isAxisAligned(plane)) {
+		return snapContours(plane, AxisAlignedFrame(plane), grid, candidates);
+	}
+	return snapContours(plane, GeneralFrame(plane), grid, candidates);
+}
+
+template<typename Frame>
+FixedPolygon Object3D::snapContours(const Plane& plane, const Frame& frame, const FixedPointGrid& grid, const std::vector<unsigned int>& candidates) const
+{
+	// As in traceContours, vertices within FLOATERROR of the plane count as below it, so each face crossing the plane
+	// holds one segment of the section, from the edge going up through the plane to the edge going down.
+	// Where an edge crosses is worked out from its lower numbered vertex, so both faces sharing the edge snap it
+	// to the same grid point and segments are joined by exact equality, without needing the neighbours of faces.
+	struct Segment {
+		Vector2i start, end;
+		uint32_t face;
+	};
+	static constexpr uint32_t none = UINT32_MAX;
+
+	Arena& arena = Arena::local();
+	PlaneSides sides(&arena);
+	classify(this->soa, plane, candidates, sides);
+
+	std::pmr::vector<Segment> segments(&arena);
+	unsigned int intersecting = 0;
+	for (size_t candidate = 0; candidate < candidates.size(); candidate++)
+	{
+		const auto& face = this->mesh.faces[candidates[candidate]];
+		std::array<bool, 3> above;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			above[i] = sides.sides[i][candidate] == 1;
+		}
+		// Counted as in linkContours
+		auto& distances = sides.distances;
+		if (!(distances[0][candidate] > 0 && distances[1][candidate] > 0 && distances[2][candidate] > 0)
+			&& !(distances[0][candidate] < 0 && distances[1][candidate] < 0 && distances[2][candidate] < 0)) {
+			intersecting++;
+		}
+		if (above[0] == above[1] && above[1] == above[2]) {
+			continue;
+		}
+
+		auto crossing = [&](unsigned int i, unsigned int j) {
+			uint32_t lower = face[i], upper = face[j];
+			float lowerDistance = sides.distances[i][candidate], upperDistance = sides.distances[j][candidate];
+			if (upper < lower) {
+				std::swap(lower, upper);
+				std::swap(lowerDistance, upperDistance);
+			}
+			const Vector3d& start = this->mesh.vertices[lower];
+			const Vector3d& end = this->mesh.vertices[upper];
+			float t = saturate(lowerDistance / (lowerDistance - upperDistance), 0.0f, 1.0f);
+			return grid.snap(frame.project(Vector3d(start + (end - start) * t)));
+		};
+		Segment segment;
+		segment.face = candidates[candidate];
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			unsigned int j = (i + 1) % 3;
+			if (!above[i] && above[j]) {
+				segment.start = crossing(i, j);
+			}
+			else if (above[i] && !above[j]) {
+				segment.end = crossing(i, j);
+			}
+		}
+		// Sections through a mesh vertex collapse in some of the faces around it
+		if (segment.start != segment.end) {
+			segments.push_back(segment);
+		}
+	}
+	if (intersecting == 0) {
+		throw std::runtime_error("Plane does not intersect");
+	}
+
+	// Both ends of every segment by point. End 2 * i is the start of segment i, 2 * i + 1 its end.
+	std::pmr::unordered_map<Vector2i, uint32_t, FixedPointHash> first(&arena); // Last end added at each point
+	first.reserve(2 * segments.size());
+	std::pmr::vector<uint32_t> next(2 * segments.size(), none, &arena); // Next end at the same point, or none
+	std::pmr::vector<bool> used(segments.size(), false, &arena);
+	auto point = [&segments](uint32_t end) -> const Vector2i& {
+		return end % 2 == 0 ? segments[end / 2].start : segments[end / 2].end;
+	};
+	auto corners = [this](uint32_t face) {
+		std::array<uint32_t, 3> corners = this->mesh.faces[face];
+		std::sort(corners.begin(), corners.end());
+		return corners;
+	};
+	for (uint32_t segment = 0; segment < segments.size(); segment++)
+	{
+		// A segment lying on another one, either way round, is a duplicated face if both faces have the same corners,
+		// and otherwise one side of a sliver with no area, like a ring of edges in the plane with faces above on both sides
+		auto found = first.find(segments[segment].start);
+		for (uint32_t end = found == first.end() ? none : found->second; end != none; end = next[end]) {
+			if (used[end / 2] || point(end ^ 1) != segments[segment].end) {
+				continue;
+			}
+			used[segment] = true;
+			if (corners(segments[end / 2].face) != corners(segments[segment].face)) {
+				used[end / 2] = true;
+			}
+			break;
+		}
+		if (used[segment]) {
+			continue;
+		}
+		for (uint32_t end = 2 * segment; end < 2 * segment + 2; end++) {
+			auto [it, inserted] = first.try_emplace(point(end), end);
+			if (!inserted) {
+				next[end] = it->second;
+				it->second = end;
+			}
+		}
+	}
+	// An unused segment with an end at the point, preferring one that starts there.
+	// Faces wound the other way from their neighbours give segments going backwards, which are followed from their end.
+	auto take = [&](const Vector2i& at) {
+		auto found = first.find(at);
+		uint32_t backwards = none;
+		for (uint32_t end = found == first.end() ? none : found->second; end != none; end = next[end]) {
+			if (used[end / 2]) {
+				continue;
+			}
+			if (end % 2 == 0) {
+				used[end / 2] = true;
+				return end;
+			}
+			if (backwards == none) {
+				backwards = end;
+			}
+		}
+		if (backwards != none) {
+			used[backwards / 2] = true;
+		}
+		return backwards;
+	};
+
+	FixedPolygon polygon;
+	for (uint32_t begin = 0; begin < segments.size(); begin++)
+	{
+		if (used[begin]) {
+			continue;
+		}
+		used[begin] = true;
+		std::pmr::vector<Vector2i> path(&arena);
+		path.push_back(segments[begin].start);
+		Vector2i at = segments[begin].end;
+		size_t reversed = 0;
+		while (at != segments[begin].start) {
+			uint32_t end = take(at);
+			if (end == none) {
+				// As linkContours, sections of meshes with holes cannot be printed as polygons
+				throw std::runtime_error("Could not link edges");
+			}
+			path.push_back(at);
+			reversed += end % 2;
+			at = point(end ^ 1);
+		}
+		// Traced clockwise around the outside of an outward facing mesh, reverse so outer paths are counterclockwise.
+		// A path mostly followed backwards went round the other way.
+		if (2 * reversed < path.size()) {
+			std::reverse(path.begin(), path.end());
+		}
+		polygon.paths.push_back(FixedSimplePolygon{ std::vector<Vector2i>(path.cbegin(), path.cend()) });
+	}
+
+	// Put the path with the rightmost vertex first, as the other intersections do
+	rightmostFirst(polygon.paths);
+	return polygon;
+}
+
 Polygon combineEdges(Polygon poly) {
 	for (auto& path : poly.paths) {
 		for (unsigned int i = 0; i < path.vertices.size(); i++) {
@@ -320,7 +866,7 @@ Polygon combineEdges(Polygon poly) {
 			Vector2d prev = path.vertices[i] - path.vertices[(i + size - 1) % size];
 			Vector2d next = path.vertices[(i + 1 + size) % size] - path.vertices[i];
 			float cross = prev[0] * next[1] - prev[1] * next[0]; // 2D cross product
-			if (abs(cross) < FLOATERROR) {
+			if (std::abs(cross) < FLOATERROR) {
 				// Remove, edge from prev to next is a straight line
 				path.vertices.erase(path.vertices.begin() + i);
 			}
@@ -329,34 +875,212 @@ Polygon combineEdges(Polygon poly) {
 	return poly;
 }
 
-std::vector<Polygon> Object3D::slice(const Plane& plane, float layerHeight)
+FixedPolygon combineEdges(FixedPolygon poly, const FixedPointGrid& grid) {
+	// The same test as the float version, in grid units. An exact test would keep nearly every vertex, as snapping
+	// moves vertices off the line they were on by up to a grid cell.
+	double limit = FLOATERROR / (grid.resolution * grid.resolution);
+	for (auto& path : poly.paths) {
+		size_t size = path.vertices.size();
+		std::vector<Vector2i> vertices;
+		vertices.reserve(size);
+		// As in the float version, the vertex after a removed one is kept, so runs of tiny edges are not all removed
+		bool keep = false;
+		for (size_t i = 0; i < size; i++) {
+			if (keep) {
+				vertices.push_back(path.vertices[i]);
+				keep = false;
+				continue;
+			}
+			const Vector2i& before = vertices.empty() ? path.vertices[size - 1] : vertices.back();
+			const Vector2i& after = i + 1 < size ? path.vertices[i + 1] : vertices.empty() ? path.vertices[0] : vertices.front();
+			Vector2i prev = path.vertices[i] - before;
+			Vector2i next = after - path.vertices[i];
+			if (std::abs(static_cast<double>(cross(prev, next))) < limit) {
+				// Remove, edge from prev to next is a straight line
+				keep = true;
+			}
+			else {
+				vertices.push_back(path.vertices[i]);
+			}
+		}
+		path.vertices = std::move(vertices);
+	}
+	return poly;
+}
+
+class SweepLine {
+	// Keeps track of the triangles that may straddle a plane moving along the slicing direction.
+	// Distances passed to advance must be non-decreasing.
+public:
+	SweepLine(const std::vector<std::pair<float, float>>& extents, const std::vector<unsigned int>& order, float tolerance)
+		: extents{ extents }, order{ order }, next{ order.cbegin() }, tolerance{ tolerance } {}
+
+	// Starts with the plane at distance, taking the triangles there from tree, which holds the same extents
+	SweepLine(const std::vector<std::pair<float, float>>& extents, const std::vector<unsigned int>& order, float tolerance,
+		const IntervalTree& tree, float distance)
+		: extents{ extents }, order{ order }, active{ tree.stab(distance, tolerance) }, tolerance{ tolerance } {
+		next = std::partition_point(order.cbegin(), order.cend(), [this, distance](unsigned int index) {
+			return this->extents[index].first <= distance + this->tolerance;
+			});
+	}
+
+	// Triangles that may straddle the plane at distance
+	const std::vector<unsigned int>& advance(float distance) {
+		// Add triangles the plane has reached
+		while (next != order.cend() && extents[*next].first <= distance + tolerance) {
+			active.push_back(*next++);
+		}
+
+		// Remove triangles the plane has passed
+		active.erase(
+			std::remove_if(active.begin(), active.end(), [this, distance](unsigned int index) {
+				return extents[index].second < distance - tolerance;
+				}),
+			active.end());
+
+		// Keep the original triangle order so edges are linked the same way as a full scan
+		candidates = active;
+		std::sort(candidates.begin(), candidates.end());
+		return candidates;
+	}
+
+private:
+	const std::vector<std::pair<float, float>>& extents;
+	const std::vector<unsigned int>& order; // Triangle indices sorted by lowest extent
+	std::vector<unsigned int>::const_iterator next;
+	std::vector<unsigned int> active, candidates;
+	float tolerance;
+};
+
+std::vector<Polygon> Object3D::slice(const Plane& plane, float layerHeight, unsigned int threads) const
 {
 	std::vector<Polygon> slices;
-	Plane intersector = plane;
+	slice(plane, layerHeight, [&slices](Polygon&& layer) {
+		slices.push_back(std::move(layer));
+		}, threads);
+	return slices;
+}
+
+template<typename Layer>
+void Object3D::sweep(const Plane& plane, float layerHeight, const std::function<LayerSlicer<Layer>()>& makeSlicer,
+	const std::function<void(Layer&&)>& consumer, unsigned int threads) const
+{
 	auto [min, max] = minMax(plane.normal);
-	float startDistance = plane.point.dot(intersector.normal) / intersector.normal.length();
+	float startDistance = plane.point.dot(plane.normal) / plane.normal.length();
 
+	std::vector<float> distances;
 	for (float distance = min; distance <= max; distance += layerHeight) {
-		intersector.point = plane.point + plane.normal * (distance - startDistance);
-		slices.push_back(combineEdges(intersect(intersector)));
+		distances.push_back(distance);
 	}
 
-	return slices;
+	// Sort triangles by their lowest extent once, then sweep the plane through them.
+	// The tolerance only widens the candidate set, intersect() does the exact test.
+	std::vector<std::pair<float, float>> extents = this->extents(plane.normal);
+	std::vector<unsigned int> order(extents.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&extents](unsigned int lhs, unsigned int rhs) {
+		return extents[lhs].first < extents[rhs].first;
+		});
+
+	auto layerAt = [&](const LayerSlicer<Layer>& sliceLayer, const Candidates& candidates, size_t layer) {
+		Plane intersector = plane;
+		intersector.point = plane.point + plane.normal * (distances[layer] - startDistance);
+		return sliceLayer(intersector, candidates);
+	};
+
+	if (threads == 1) {
+		SweepLine sweeper(extents, order, layerHeight / 2);
+		LayerSlicer<Layer> sliceLayer = makeSlicer();
+		for (size_t layer = 0; layer < distances.size(); layer++) {
+			consumer(layerAt(sliceLayer, [&]() { return sweeper.advance(distances[layer]); }, layer));
+		}
+		return;
+	}
+
+	// Runs of a few layers are separate tasks, so a slow layer does not hold up the others, and a slicer
+	// carries what it can through its run. Each run sweeps its own layers, starting from the triangles
+	// the interval tree finds at its first layer.
+	// A window is sliced at a time and handed to consumer in order, so at most a window is kept in memory.
+	PoolHandle pool(threads);
+	IntervalTree tree(extents, order);
+	constexpr size_t run = 8;
+	size_t window = 4 * run * static_cast<size_t>(pool.size());
+	std::vector<Layer> layers(window);
+	for (size_t begin = 0; begin < distances.size(); begin += window) {
+		size_t end = std::min(begin + window, distances.size());
+		pool.parallelFor(end - begin, [&](size_t first, size_t last) {
+			SweepLine sweeper(extents, order, layerHeight / 2, tree, distances[begin + first]);
+			LayerSlicer<Layer> sliceLayer = makeSlicer();
+			for (size_t layer = begin + first; layer < begin + last; layer++) {
+				layers[layer - begin] = layerAt(sliceLayer, [&]() { return sweeper.advance(distances[layer]); }, layer);
+			}
+			}, run);
+		for (size_t layer = begin; layer < end; layer++) {
+			consumer(std::move(layers[layer - begin]));
+		}
+	}
 }
 
-std::pair<float, float> Object3D::minMax(const Vector3d& direction)
+void Object3D::slice(const Plane& plane, float layerHeight, const std::function<void(Polygon&&)>& consumer, unsigned int threads) const
+{
+	if (!this->mesh.closed()) {
+		sweep<Polygon>(plane, layerHeight, [this]() -> LayerSlicer<Polygon> {
+			return [this](const Plane& intersector, const Candidates& candidates) {
+				return combineEdges(intersect(intersector, candidates()));
+			};
+			}, consumer, threads);
+		return;
+	}
+
+	// Sections of closed meshes are carried from layer to layer by a tracker for each run of layers
+	ContourTracker::Vertices vertices(this->mesh, plane.normal);
+	float tolerance = this->tolerance(plane.normal);
+	sweep<Polygon>(plane, layerHeight, [this, &vertices, tolerance]() -> LayerSlicer<Polygon> {
+		auto tracker = std::make_shared<ContourTracker>(this->mesh, this->soa, vertices, tolerance);
+		return [this, tracker](const Plane& intersector, const Candidates& candidates) {
+			return combineEdges(intersect(intersector, *tracker, candidates));
+		};
+		}, consumer, threads);
+}
+
+void Object3D::slice(const Plane& plane, float layerHeight, const FixedPointGrid& grid, const std::function<void(FixedPolygon&&)>& consumer, unsigned int threads) const
+{
+	sweep<FixedPolygon>(plane, layerHeight, [this, &grid]() -> LayerSlicer<FixedPolygon> {
+		return [this, &grid](const Plane& intersector, const Candidates& candidates) {
+			return combineEdges(intersect(intersector, grid, candidates()), grid);
+		};
+		}, consumer, threads);
+}
+
+std::vector<std::pair<float, float>> Object3D::extents(const Vector3d& direction) const
+{
+	// Lowest and highest distance along direction of each triangle
+	float directionLength = direction.length();
+	std::vector<std::pair<float, float>> result(this->mesh.size());
+	std::transform(this->mesh.faces.cbegin(), this->mesh.faces.cend(), result.begin(),
+		[this, &direction, directionLength](const std::array<uint32_t, 3>& face) {
+			float min = INFINITY, max = -INFINITY;
+			for (uint32_t vertex : face) {
+				float distance = this->mesh.vertices[vertex].dot(direction);
+				min = std::min(min, distance);
+				max = std::max(max, distance);
+			}
+			return std::make_pair(min / directionLength, max / directionLength);
+		});
+	return result;
+}
+
+std::pair<float, float> Object3D::minMax(const Vector3d& direction) const
 {
 	float min = INFINITY, max = -INFINITY;
-	for (const auto& triangle : this->triangles)
+	for (const auto& vertex : this->mesh.vertices)
 	{
-		for (const auto& vertex : triangle.vertices) {
-			float distance = vertex.dot(direction);
-			if (distance < min) {
-				min = distance;
-			}
-			if (distance > max) {
-				max = distance;
-			}
+		float distance = vertex.dot(direction);
+		if (distance < min) {
+			min = distance;
+		}
+		if (distance > max) {
+			max = distance;
 		}
 	}
 	// Length of direction factored out from loop
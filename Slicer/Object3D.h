@@ -1,21 +1,79 @@
 #pragma once
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "bvh.h"
+#include "contourtracker.h"
 #include "geometry.h"
+#include "intervaltree.h"
+#include "mesh.h"
+#include "trianglesoa.h"
 
 using std::string;
 
 class Object3D
 {
 public:
-	void fromFile(string filename, bool binary = false);
+	// Threads are used for parsing ASCII files, zero uses one thread per hardware thread
+	void fromFile(string filename, bool binary = false, unsigned int threads = 1);
+	// intersect and slice only read the object and may be called from several threads at once
 	Polygon intersect(const Plane& plane) const;
-	std::vector<Polygon> slice(const Plane& start, float layerHeight);
+	// Cross sections of planes of any orientation, finding the faces each plane touches in a single pass over the mesh.
+	// Zero threads uses one thread per hardware thread.
+	std::vector<Polygon> intersect(const std::vector<Plane>& planes, unsigned int threads = 1) const;
+	// Zero threads uses one thread per hardware thread
+	std::vector<Polygon> slice(const Plane& start, float layerHeight, unsigned int threads = 1) const;
+	// Hands each layer to consumer in order as soon as it is sliced, instead of keeping every layer
+	void slice(const Plane& start, float layerHeight, const std::function<void(Polygon&&)>& consumer, unsigned int threads = 1) const;
+	// Cross sections snapped onto grid, where the ends of the edges in each face are joined by exact equality
+	// instead of within FLOATERROR. Needs no face neighbours, so meshes failing closed() work as long as every section
+	// closes. Faces wound the wrong way are followed backwards, and sections that do not close throw as in float mode.
+	FixedPolygon intersect(const Plane& plane, const FixedPointGrid& grid) const;
+	void slice(const Plane& start, float layerHeight, const FixedPointGrid& grid, const std::function<void(FixedPolygon&&)>& consumer, unsigned int threads = 1) const;
 private:
-	std::vector<Triangle3d> triangles;
+	Mesh mesh;
+	TriangleSoA soa; // Copy of the mesh faces for classifying many faces at once
 
-	void fromASCIIFile(string filename);
+	BoundingVolumeHierarchy bvh; // For finding the faces touching planes of any orientation
+	float size = 0.0f; // Distance from origin to the farthest vertex
+
+	struct ExtentIndex {
+		Vector3d direction; // Normalized
+		std::optional<IntervalTree> tree; // Extents of the faces along direction, once direction has been asked for again
+	};
+	// Index for the last direction intersect() was called with, replaced when the direction changes
+	mutable std::shared_ptr<const ExtentIndex> extentIndex;
+	float tolerance(const Vector3d& normal) const;
+	// Faces that may touch plane, in ascending order
+	std::vector<unsigned int> candidates(const Plane& plane) const;
+
+	Polygon intersect(const Plane& plane, const std::vector<unsigned int>& candidates) const;
+	// Frame projects into the plane, AxisAlignedFrame where possible and GeneralFrame otherwise
+	template<typename Frame>
+	std::optional<Polygon> traceContours(const Plane& plane, const Frame& frame, const std::vector<unsigned int>& candidates) const;
+	template<typename Frame>
+	Polygon linkContours(const Plane& plane, const Frame& frame, const std::vector<unsigned int>& candidates) const;
+	template<typename Frame>
+	Polygon intersect(const Plane& plane, const Frame& frame, const std::vector<unsigned int>& candidates) const;
+	FixedPolygon intersect(const Plane& plane, const FixedPointGrid& grid, const std::vector<unsigned int>& candidates) const;
+	template<typename Frame>
+	FixedPolygon snapContours(const Plane& plane, const Frame& frame, const FixedPointGrid& grid, const std::vector<unsigned int>& candidates) const;
+	// Faces that may touch a layer, only looked up if the layer needs them
+	using Candidates = std::function<std::vector<unsigned int>()>;
+	// Slices consecutive layers in order, and may keep what it learns from one layer for the next
+	template<typename Layer>
+	using LayerSlicer = std::function<Layer(const Plane&, const Candidates&)>;
+	// Sweeps a plane through the object. Each run of consecutive layers is sliced by a new slicer from makeSlicer.
+	template<typename Layer>
+	void sweep(const Plane& start, float layerHeight, const std::function<LayerSlicer<Layer>()>& makeSlicer,
+		const std::function<void(Layer&&)>& consumer, unsigned int threads) const;
+	Polygon intersect(const Plane& plane, ContourTracker& tracker, const Candidates& candidates) const;
+	std::vector<std::pair<float, float>> extents(const Vector3d& direction) const;
+
+	void fromASCIIFile(string filename, unsigned int threads);
 	void fromBinaryFile(string filename);
-	std::pair<float, float> minMax(const Vector3d& direction);
+	std::pair<float, float> minMax(const Vector3d& direction) const;
 };
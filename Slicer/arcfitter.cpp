@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "arcfitter.h"
+
+float ArcStats::ratio() const
+{
+	return this->commandsAfter > 0 ? static_cast<float>(this->commandsBefore) / this->commandsAfter : 1.0f;
+}
+
+ArcStats& ArcStats::operator+=(const ArcStats& other)
+{
+	this->commandsBefore += other.commandsBefore;
+	this->commandsAfter += other.commandsAfter;
+	this->movesReplaced += other.movesReplaced;
+	this->arcs += other.arcs;
+	this->maxDeviation = std::max(this->maxDeviation, other.maxDeviation);
+	return *this;
+}
+
+std::ostream& operator<<(std::ostream& os, const ArcStats& stats)
+{
+	os << stats.commandsBefore << " -> " << stats.commandsAfter << " commands (ratio " << std::fixed << std::setprecision(2) << stats.ratio()
+		<< "), " << stats.movesReplaced << " moves in " << stats.arcs << " arcs, max deviation " << std::setprecision(4) << stats.maxDeviation << " mm"
+		<< std::defaultfloat;
+	return os;
+}
+
+ArcFitter::ArcFitter(float deviation) : deviation{ deviation }
+{
+}
+
+std::vector<Command> ArcFitter::fit(const std::vector<Command>& commands, ArcStats& stats)
+{
+	std::vector<Command> result;
+	result.reserve(commands.size());
+	ArcStats layer;
+	size_t begin = 0;
+	while (begin < commands.size()) {
+		if (!this->known || !isExtrudingMove(commands[begin])) {
+			result.push_back(commands[begin]);
+			follow(commands[begin]);
+			begin++;
+			continue;
+		}
+		// Moves at one feed rate that keep extruding
+		size_t end = begin + 1;
+		while (end < commands.size() && isExtrudingMove(commands[end])
+			&& commands[end]['F'] == commands[begin]['F'] && commands[end]['E'] >= commands[end - 1]['E']) {
+			end++;
+		}
+		std::vector<Command> moves(commands.begin() + begin, commands.begin() + end);
+		fitRun(moves, result, layer);
+		follow(moves.back());
+		begin = end;
+	}
+	layer.commandsBefore = commands.size();
+	layer.commandsAfter = result.size();
+	stats = layer;
+	return result;
+}
+
+bool ArcFitter::fits(const std::vector<Vector2d>& points, size_t first, size_t last, Arc& arc) const
+{
+	// Circle through the first, middle and last point
+	double ax = points[first][0], ay = points[first][1];
+	const Vector2d& middle = points[(first + last) / 2];
+	double bx = middle[0] - ax, by = middle[1] - ay;
+	double cx = points[last][0] - ax, cy = points[last][1] - ay;
+	double d = 2 * (bx * cy - by * cx);
+	if (d == 0) {
+		return false;
+	}
+	double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+	double ux = (cy * b2 - by * c2) / d, uy = (bx * c2 - cx * b2) / d;
+	double radius = std::sqrt(ux * ux + uy * uy);
+	if (radius > maxRadius) {
+		return false;
+	}
+	arc.centreX = ax + ux;
+	arc.centreY = ay + uy;
+	arc.counterclockwise = d > 0;
+
+	// Every point and segment middle close to the circle, and the points going one way round it for at most half a turn.
+	// Turning one way, the arc passes half a turn where it crosses the line through the centre and the first point.
+	double direction = arc.counterclockwise ? 1 : -1;
+	double fx = -ux, fy = -uy;
+	double worst = 0;
+	for (size_t i = first; i <= last; i++) {
+		double px = points[i][0] - arc.centreX, py = points[i][1] - arc.centreY;
+		worst = std::max(worst, std::abs(std::sqrt(px * px + py * py) - radius));
+		if (i == last) {
+			break;
+		}
+		double qx = points[i + 1][0] - arc.centreX, qy = points[i + 1][1] - arc.centreY;
+		double mx = (px + qx) / 2, my = (py + qy) / 2;
+		worst = std::max(worst, std::abs(std::sqrt(mx * mx + my * my) - radius));
+		if ((px * qy - py * qx) * direction <= 0 || (fx * qy - fy * qx) * direction < 0 || worst > this->deviation) {
+			return false;
+		}
+	}
+	arc.deviation = static_cast<float>(worst);
+	return true;
+}
+
+void ArcFitter::fitRun(const std::vector<Command>& moves, std::vector<Command>& result, ArcStats& stats) const
+{
+	// The run starts at the current position, and each move goes on to the next point
+	std::vector<Vector2d> points{ Vector2d{ this->x, this->y } };
+	for (const auto& move : moves) {
+		points.push_back(Vector2d{ move['X'], move['Y'] });
+	}
+
+	size_t first = 0;
+	while (first < moves.size()) {
+		// Longest arc from the point, found by doubling the moves and then halving the gap between fitting and not
+		Arc arc{}, candidate{};
+		size_t fitted = 0, tried = minMoves;
+		while (first + tried <= moves.size() && fits(points, first, first + tried, candidate)) {
+			fitted = tried;
+			arc = candidate;
+			tried *= 2;
+		}
+		if (fitted > 0) {
+			size_t failed = std::min(tried, moves.size() - first + 1);
+			while (failed - fitted > 1) {
+				size_t count = (fitted + failed) / 2;
+				if (fits(points, first, first + count, candidate)) {
+					fitted = count;
+					arc = candidate;
+				}
+				else {
+					failed = count;
+				}
+			}
+		}
+
+		if (fitted == 0) {
+			result.push_back(moves[first]);
+			first++;
+			continue;
+		}
+		const Command& last = moves[first + fitted - 1];
+		float I = static_cast<float>(arc.centreX - points[first][0]);
+		float J = static_cast<float>(arc.centreY - points[first][1]);
+		result.push_back(arc.counterclockwise
+			? Command::arcCounterclockwise(last['E'], last['F'], I, J, last['X'], last['Y'])
+			: Command::arcClockwise(last['E'], last['F'], I, J, last['X'], last['Y']));
+		stats.movesReplaced += fitted;
+		stats.arcs++;
+		stats.maxDeviation = std::max(stats.maxDeviation, arc.deviation);
+		first += fitted;
+	}
+}
+
+void ArcFitter::follow(const Command& command)
+{
+	bool moves = command.is('G', 0) || command.is('G', 1) || command.is('G', 2) || command.is('G', 3) || command.is('G', 92);
+	if (!moves) {
+		return;
+	}
+	if (command.has('X')) {
+		this->x = command['X'];
+	}
+	if (command.has('Y')) {
+		this->y = command['Y'];
+	}
+	// Known once a command has given both
+	this->known = this->known || (command.has('X') && command.has('Y'));
+}
+
+bool ArcFitter::isExtrudingMove(const Command& command)
+{
+	return command.is('G', 1) && command.has('E') && command.has('F') && command.has('X') && command.has('Y');
+}
+
+ArcFittingSink::ArcFittingSink(CommandSink& sink, float deviation)
+	: sink{ sink }, fitter(deviation)
+{
+}
+
+void ArcFittingSink::push(const std::vector<Command>& commands)
+{
+	ArcStats stats;
+	this->sink.push(this->fitter.fit(commands, stats));
+	this->pushes.push_back(stats);
+}
+
+void ArcFittingSink::finish()
+{
+	this->sink.finish();
+}
+
+const std::vector<ArcStats>& ArcFittingSink::stats() const
+{
+	return this->pushes;
+}
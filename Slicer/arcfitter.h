@@ -0,0 +1,63 @@
+#pragma once
+#include <iostream>
+#include <vector>
+
+#include "gcode.h"
+
+struct ArcStats {
+	// What fitting did to the commands of a layer
+	size_t commandsBefore = 0, commandsAfter = 0;
+	size_t movesReplaced = 0; // Moves turned into arcs
+	size_t arcs = 0;
+	float maxDeviation = 0.0f; // mm, furthest the arcs pass from the moves they replace
+
+	// Commands before for each command after
+	float ratio() const;
+	ArcStats& operator+=(const ArcStats& other);
+};
+
+std::ostream& operator<<(std::ostream& os, const ArcStats& stats);
+
+class ArcFitter {
+	// Replaces runs of extruding moves that lie on a circle with G2 and G3 arcs.
+	// The vertices of the moves and the middles of their segments stay within deviation of the arcs.
+	// Follows the position from command to command, so the commands of a print must be given in order.
+public:
+	explicit ArcFitter(float deviation);
+	std::vector<Command> fit(const std::vector<Command>& commands, ArcStats& stats);
+private:
+	struct Arc {
+		double centreX, centreY;
+		bool counterclockwise;
+		float deviation;
+	};
+
+	// Moves an arc replaces at least
+	static constexpr size_t minMoves = 3;
+	// Larger circles are too close to straight lines to be worth an arc
+	static constexpr double maxRadius = 1000.0;
+
+	float deviation;
+	bool known = false; // Whether the position is known
+	float x = 0.0f, y = 0.0f;
+
+	// Arc from points[first] through points[last], if the points in between lie on it
+	bool fits(const std::vector<Vector2d>& points, size_t first, size_t last, Arc& arc) const;
+	void fitRun(const std::vector<Command>& moves, std::vector<Command>& result, ArcStats& stats) const;
+	void follow(const Command& command);
+	static bool isExtrudingMove(const Command& command);
+};
+
+class ArcFittingSink : public CommandSink {
+	// Fits arcs to the pushed commands before passing them on to sink
+public:
+	ArcFittingSink(CommandSink& sink, float deviation);
+	void push(const std::vector<Command>& commands) override;
+	void finish() override;
+	// Stats of each push
+	const std::vector<ArcStats>& stats() const;
+private:
+	CommandSink& sink;
+	ArcFitter fitter;
+	std::vector<ArcStats> pushes;
+};
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <memory>
+#include <new>
+
+#include "arena.h"
+
+Arena::Arena(size_t blockSize) : blockSize{ blockSize }
+{
+}
+
+Arena::~Arena()
+{
+	for (const auto& block : blocks) {
+		::operator delete(block.data);
+	}
+}
+
+void Arena::reset()
+{
+	if (blocks.size() > 1) {
+		// Replace the blocks by one that fits everything, so the next round fits in a single block
+		size_t total = 0;
+		for (const auto& block : blocks) {
+			total += block.size;
+			::operator delete(block.data);
+		}
+		blocks.clear();
+		blocks.push_back({ static_cast<char*>(::operator new(total)), total });
+	}
+	current = 0;
+	used = 0;
+}
+
+Arena& Arena::local()
+{
+	thread_local Arena arena;
+	return arena;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment)
+{
+	while (current < blocks.size()) {
+		void* pointer = blocks[current].data + used;
+		size_t space = blocks[current].size - used;
+		if (std::align(alignment, bytes, pointer, space)) {
+			used = blocks[current].size - space + bytes;
+			return pointer;
+		}
+		current++;
+		used = 0;
+	}
+
+	// Out of blocks, the new block is large enough for the allocation at any alignment
+	size_t size = std::max(blockSize, bytes + alignment);
+	blocks.push_back({ static_cast<char*>(::operator new(size)), size });
+	current = blocks.size() - 1;
+	used = 0;
+	return do_allocate(bytes, alignment);
+}
+
+void Arena::do_deallocate(void*, size_t, size_t)
+{
+	// Memory is released by reset
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <memory_resource>
+#include <vector>
+
+class Arena : public std::pmr::memory_resource
+{
+	// Bump allocator for scratch memory that is released all at once.
+	// Memory is kept between resets, so repeated work of similar size does not use the general heap.
+public:
+	explicit Arena(size_t blockSize = 1 << 20);
+	~Arena();
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// Invalidates everything allocated since the last reset
+	void reset();
+
+	// Arena owned by the calling thread
+	static Arena& local();
+private:
+	struct Block {
+		char* data;
+		size_t size;
+	};
+	std::vector<Block> blocks;
+	size_t current = 0; // Block allocations are made from
+	size_t used = 0; // Bytes used of current block
+	size_t blockSize;
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "bvh.h"
+
+namespace {
+	// Signed distance from plane to point along the plane normal
+	float distance(const Plane& plane, const Vector3d& point) {
+		return plane.normal.dot(point - plane.point) / plane.normal.length();
+	}
+
+	bool touches(const Plane& plane, const Vector3d& min, const Vector3d& max, float tolerance) {
+		// The box spans radius around its center along the normal
+		Vector3d center = (min + max) * 0.5f;
+		Vector3d halfSize = (max - min) * 0.5f;
+		float radius = 0.0f;
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			radius += halfSize[axis] * std::abs(plane.normal[axis]);
+		}
+		radius /= plane.normal.length();
+		return std::abs(distance(plane, center)) <= radius + tolerance;
+	}
+
+	bool touches(const Plane& plane, const Mesh& mesh, unsigned int face, float tolerance) {
+		const auto& corners = mesh.faces[face];
+		float d0 = distance(plane, mesh.vertices[corners[0]]), d1 = distance(plane, mesh.vertices[corners[1]]), d2 = distance(plane, mesh.vertices[corners[2]]);
+		return std::min({ d0, d1, d2 }) <= tolerance && std::max({ d0, d1, d2 }) >= -tolerance;
+	}
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(const Mesh& mesh)
+{
+	if (mesh.faces.empty()) {
+		return;
+	}
+	faces.resize(mesh.size());
+	std::iota(faces.begin(), faces.end(), 0);
+	std::vector<Vector3d> centroids(mesh.size());
+	for (size_t face = 0; face < mesh.size(); face++)
+	{
+		const auto& indices = mesh.faces[face];
+		centroids[face] = (mesh.vertices[indices[0]] + mesh.vertices[indices[1]] + mesh.vertices[indices[2]]) / 3.0f;
+	}
+	nodes.reserve(2 * mesh.size() / leafSize + 1);
+	build(0, static_cast<uint32_t>(faces.size()), centroids);
+
+	for (auto& node : nodes) {
+		// Boxes are computed from the vertices, centroids were only used for splitting
+		if (node.count == 0) {
+			continue;
+		}
+		node.min = Vector3d{ INFINITY, INFINITY, INFINITY };
+		node.max = Vector3d{ -INFINITY, -INFINITY, -INFINITY };
+		for (uint32_t i = node.first; i < node.first + node.count; i++) {
+			for (uint32_t corner : mesh.faces[faces[i]]) {
+				const Vector3d& vertex = mesh.vertices[corner];
+				for (unsigned int axis = 0; axis < 3; axis++)
+				{
+					node.min[axis] = std::min(node.min[axis], vertex[axis]);
+					node.max[axis] = std::max(node.max[axis], vertex[axis]);
+				}
+			}
+		}
+	}
+	// Children come after their parent, so going backwards fills inner boxes from finished children
+	for (size_t i = nodes.size(); i-- > 0;) {
+		Node& node = nodes[i];
+		if (node.count != 0) {
+			continue;
+		}
+		const Node& left = nodes[i + 1];
+		const Node& right = nodes[node.right];
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			node.min[axis] = std::min(left.min[axis], right.min[axis]);
+			node.max[axis] = std::max(left.max[axis], right.max[axis]);
+		}
+	}
+}
+
+uint32_t BoundingVolumeHierarchy::build(uint32_t first, uint32_t count, std::vector<Vector3d>& centroids)
+{
+	uint32_t index = static_cast<uint32_t>(nodes.size());
+	nodes.push_back(Node{ {}, {}, first, count, 0 });
+	if (count <= leafSize) {
+		return index;
+	}
+
+	Vector3d min{ INFINITY, INFINITY, INFINITY }, max{ -INFINITY, -INFINITY, -INFINITY };
+	for (uint32_t i = first; i < first + count; i++) {
+		const Vector3d& centroid = centroids[faces[i]];
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			min[axis] = std::min(min[axis], centroid[axis]);
+			max[axis] = std::max(max[axis], centroid[axis]);
+		}
+	}
+	unsigned int axis = 0;
+	for (unsigned int i = 1; i < 3; i++)
+	{
+		if (max[i] - min[i] > max[axis] - min[axis]) {
+			axis = i;
+		}
+	}
+
+	uint32_t half = count / 2;
+	std::nth_element(faces.begin() + first, faces.begin() + first + half, faces.begin() + first + count,
+		[&centroids, axis](unsigned int lhs, unsigned int rhs) {
+			return centroids[lhs][axis] < centroids[rhs][axis];
+		});
+	nodes[index].count = 0;
+	build(first, half, centroids);
+	uint32_t right = build(first + half, count - half, centroids);
+	nodes[index].right = right;
+	return index;
+}
+
+std::vector<unsigned int> BoundingVolumeHierarchy::intersecting(const Mesh& mesh, const Plane& plane, float tolerance) const
+{
+	return std::move(intersecting(mesh, std::vector<Plane>{ plane }, tolerance).front());
+}
+
+std::vector<std::vector<unsigned int>> BoundingVolumeHierarchy::intersecting(const Mesh& mesh, const std::vector<Plane>& planes, float tolerance) const
+{
+	std::vector<std::vector<unsigned int>> result(planes.size());
+	if (!nodes.empty() && !planes.empty()) {
+		std::vector<unsigned int> active(planes.size());
+		std::iota(active.begin(), active.end(), 0);
+		traverse(mesh, 0, planes, tolerance, active, 0, result);
+	}
+	for (auto& faces : result) {
+		std::sort(faces.begin(), faces.end());
+	}
+	return result;
+}
+
+void BoundingVolumeHierarchy::traverse(const Mesh& mesh, uint32_t index, const std::vector<Plane>& planes, float tolerance, std::vector<unsigned int>& active, size_t begin,
+	std::vector<std::vector<unsigned int>>& result) const
+{
+	// active[begin, end) are the planes touching the parent. The ones touching this node are appended
+	// after them for the children, and removed again before returning.
+	const Node& node = nodes[index];
+	size_t end = active.size();
+	for (size_t i = begin; i < end; i++)
+	{
+		if (touches(planes[active[i]], node.min, node.max, tolerance)) {
+			active.push_back(active[i]);
+		}
+	}
+	if (active.size() > end) {
+		if (node.count == 0) {
+			traverse(mesh, index + 1, planes, tolerance, active, end, result);
+			traverse(mesh, node.right, planes, tolerance, active, end, result);
+		}
+		else {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				for (size_t plane = end; plane < active.size(); plane++)
+				{
+					if (touches(planes[active[plane]], mesh, faces[i], tolerance)) {
+						result[active[plane]].push_back(faces[i]);
+					}
+				}
+			}
+		}
+	}
+	active.resize(end);
+}
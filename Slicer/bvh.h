@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "geometry.h"
+#include "mesh.h"
+
+class BoundingVolumeHierarchy
+{
+	// Tree of axis aligned boxes around the faces of a mesh, for finding the faces a plane of any orientation touches.
+	// Children of a node split its faces in two halves along the longest axis of their centroids.
+public:
+	BoundingVolumeHierarchy() = default;
+	explicit BoundingVolumeHierarchy(const Mesh& mesh);
+
+	// Faces with a vertex within tolerance of the plane on both sides or on it, in ascending order.
+	// The faces are read from mesh, which must be the mesh the hierarchy was built from.
+	std::vector<unsigned int> intersecting(const Mesh& mesh, const Plane& plane, float tolerance = 0.0f) const;
+	// Same for each of planes, from a single traversal where each node is only tested against the planes touching its parent
+	std::vector<std::vector<unsigned int>> intersecting(const Mesh& mesh, const std::vector<Plane>& planes, float tolerance = 0.0f) const;
+private:
+	struct Node {
+		Vector3d min, max;
+		uint32_t first, count; // Range of faces for a leaf, count is zero for inner nodes
+		uint32_t right; // Index of the second child of an inner node, the first child follows the node
+	};
+	static constexpr uint32_t leafSize = 4;
+
+	std::vector<Node> nodes;
+	std::vector<unsigned int> faces; // Face indices ordered so each leaf covers a range
+
+	uint32_t build(uint32_t first, uint32_t count, std::vector<Vector3d>& centroids);
+	void traverse(const Mesh& mesh, uint32_t node, const std::vector<Plane>& planes, float tolerance, std::vector<unsigned int>& active, size_t begin,
+		std::vector<std::vector<unsigned int>>& result) const;
+};
@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <array>
+
+#include "arena.h"
+#include "contourtracker.h"
+
+ContourTracker::Vertices::Vertices(const Mesh& mesh, const Vector3d& direction)
+	: byDistance(mesh.vertices.size()), face(mesh.vertices.size(), Mesh::none), faces(mesh.vertices.size(), 0)
+{
+	Vector3d normal = direction.normalized();
+	for (uint32_t vertex = 0; vertex < mesh.vertices.size(); vertex++)
+	{
+		byDistance[vertex] = { mesh.vertices[vertex].dot(normal), vertex };
+	}
+	std::sort(byDistance.begin(), byDistance.end());
+
+	for (uint32_t index = 0; index < mesh.faces.size(); index++)
+	{
+		for (uint32_t vertex : mesh.faces[index]) {
+			face[vertex] = index;
+			faces[vertex]++;
+		}
+	}
+}
+
+ContourTracker::ContourTracker(const Mesh& mesh, const TriangleSoA& soa, const Vertices& vertices, float tolerance)
+	: mesh{ mesh }, soa{ soa }, vertices{ vertices }, tolerance{ tolerance }, plane{ Vector3d{ 0, 0, 0 }, Vector3d{ 0, 0, 1 }, Vector3d{ 1, 0, 0 } },
+	waiting(mesh.vertices.size(), false)
+{
+}
+
+bool ContourTracker::trace(const Plane& plane, const std::vector<unsigned int>& candidates)
+{
+	moveTo(plane);
+	traced = false;
+	nodes.clear();
+	unused.clear();
+	nodeOf.clear();
+
+	Arena& arena = Arena::local();
+	arena.reset();
+	PlaneSides sides(&arena);
+	classify(this->soa, plane, candidates, sides);
+
+	// A node for each face crossing the plane, linked to the node of the face across its edge going down
+	std::pmr::unordered_map<uint32_t, uint32_t> nodeOfFace(&arena);
+	std::pmr::vector<uint32_t> downFace(&arena);
+	for (size_t candidate = 0; candidate < candidates.size(); candidate++)
+	{
+		uint32_t face = candidates[candidate];
+		const auto& corners = this->mesh.faces[face];
+		std::array<bool, 3> above;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			above[i] = sides.sides[i][candidate] == 1;
+		}
+		if (above[0] == above[1] && above[1] == above[2]) {
+			continue;
+		}
+
+		Node node{ none, none, face, none, none };
+		unsigned int down = 0;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			unsigned int j = (i + 1) % 3;
+			if (!above[i] && above[j]) {
+				node.below = corners[i];
+				node.above = corners[j];
+			}
+			else if (above[i] && !above[j]) {
+				down = i;
+			}
+		}
+		nodeOfFace.emplace(face, static_cast<uint32_t>(this->nodes.size()));
+		downFace.push_back(this->mesh.neighbours[face][down]);
+		this->nodes.push_back(node);
+	}
+	if (this->nodes.empty()) {
+		return false;
+	}
+	for (uint32_t node = 0; node < this->nodes.size(); node++)
+	{
+		auto following = nodeOfFace.find(downFace[node]);
+		if (following == nodeOfFace.end() || this->nodes[following->second].prev != none) {
+			return false;
+		}
+		this->nodes[node].next = following->second;
+		this->nodes[following->second].prev = node;
+		if (!this->nodeOf.emplace(key(this->nodes[node].below, this->nodes[node].above), node).second) {
+			return false;
+		}
+	}
+
+	// Vertices well below the plane stay below it, the others are watched until the plane passes them
+	float along = plane.point.dot(plane.normal);
+	const auto& byDistance = this->vertices.byDistance;
+	this->next = std::lower_bound(byDistance.cbegin(), byDistance.cend(), std::make_pair(along - this->tolerance, 0u)) - byDistance.cbegin();
+	this->pending.clear();
+	for (; this->next < byDistance.size() && byDistance[this->next].first <= along + this->tolerance; this->next++) {
+		if (above(byDistance[this->next].second)) {
+			this->pending.push_back(byDistance[this->next].second);
+		}
+	}
+	traced = true;
+	return true;
+}
+
+bool ContourTracker::advance(const Plane& plane)
+{
+	if (!traced) {
+		return false;
+	}
+	moveTo(plane);
+	float along = plane.point.dot(plane.normal);
+	const auto& byDistance = this->vertices.byDistance;
+	for (; this->next < byDistance.size() && byDistance[this->next].first <= along + this->tolerance; this->next++) {
+		this->pending.push_back(byDistance[this->next].second);
+	}
+
+	// Vertices the plane passed since the last layer, in the order it passed them
+	std::vector<uint32_t> passed;
+	size_t kept = 0;
+	for (uint32_t vertex : this->pending) {
+		if (above(vertex)) {
+			this->pending[kept++] = vertex;
+		}
+		else {
+			passed.push_back(vertex);
+		}
+	}
+	this->pending.resize(kept);
+	// Splicing many vertices costs more than tracing the faces again
+	if (passed.size() * 4 > this->nodes.size() - this->unused.size()) {
+		traced = false;
+		return false;
+	}
+
+	// Each splice sees the vertices passed after it still above, as the loops have them
+	for (uint32_t vertex : passed) {
+		this->waiting[vertex] = true;
+	}
+	bool spliced = true;
+	for (uint32_t vertex : passed) {
+		this->waiting[vertex] = false;
+		spliced = spliced && splice(vertex);
+	}
+	traced = spliced;
+	return spliced;
+}
+
+template<typename Frame>
+Polygon ContourTracker::polygon(const Frame& frame) const
+{
+	// Loops start at their lowest face and come in the order of those faces, as traceContours takes faces in order
+	std::vector<std::pair<uint32_t, uint32_t>> starts; // Lowest face of each loop and its node
+	std::vector<bool> visited(this->nodes.size(), false);
+	for (uint32_t node = 0; node < this->nodes.size(); node++)
+	{
+		if (this->nodes[node].face == none || visited[node]) {
+			continue;
+		}
+		std::pair<uint32_t, uint32_t> lowest{ this->nodes[node].face, node };
+		uint32_t current = node;
+		do {
+			visited[current] = true;
+			lowest = std::min(lowest, std::make_pair(this->nodes[current].face, current));
+			current = this->nodes[current].next;
+		} while (current != node);
+		starts.push_back(lowest);
+	}
+	std::sort(starts.begin(), starts.end());
+
+	Polygon polygon;
+	std::vector<Vector2d> path;
+	for (auto [face, first] : starts) {
+		path.clear();
+		uint32_t node = first;
+		do {
+			// Interpolated as traceContours does
+			const Node& edge = this->nodes[node];
+			const Vector3d& start = this->mesh.vertices[edge.below];
+			const Vector3d& end = this->mesh.vertices[edge.above];
+			float below = distance(edge.below), above = distance(edge.above);
+			float t = saturate(below / (below - above), 0.0f, 1.0f);
+			Vector2d vertex = frame.project(Vector3d(start + (end - start) * t));
+			// Sections through a mesh vertex enter several faces at the same point
+			if (path.empty() || !vertex.isClose(path.back())) {
+				path.push_back(vertex);
+			}
+			node = edge.next;
+		} while (node != first);
+
+		if (path.size() > 1 && path.back().isClose(path.front())) {
+			path.pop_back();
+		}
+		if (path.size() >= 3) {
+			// Traced clockwise around the outside of an outward facing mesh, reverse so outer paths are counterclockwise
+			std::reverse(path.begin(), path.end());
+			polygon.paths.push_back(SimplePolygon{ path });
+		}
+	}
+	rightmostFirst(polygon.paths);
+	return polygon;
+}
+
+template Polygon ContourTracker::polygon(const AxisAlignedFrame& frame) const;
+template Polygon ContourTracker::polygon(const GeneralFrame& frame) const;
+
+void ContourTracker::moveTo(const Plane& plane)
+{
+	this->plane = plane;
+	this->axisAligned = isAxisAligned(plane);
+}
+
+float ContourTracker::distance(uint32_t vertex) const
+{
+	const Vector3d& point = this->mesh.vertices[vertex];
+	if (this->axisAligned) {
+		return planeDistance<true>(this->plane, point[0], point[1], point[2]);
+	}
+	return planeDistance<false>(this->plane, point[0], point[1], point[2]);
+}
+
+bool ContourTracker::above(uint32_t vertex) const
+{
+	return this->waiting[vertex] || distance(vertex) > FLOATERROR;
+}
+
+bool ContourTracker::splice(uint32_t vertex)
+{
+	// The plane has passed vertex, which was above it and is now below.
+	// The edges from below up to vertex stop crossing the plane, and the edges from vertex up start to.
+	uint32_t count = this->vertices.faces[vertex];
+	if (count == 0) {
+		return true;
+	}
+
+	// Vertices around vertex, in the order of the faces around it
+	ring.clear();
+	uint32_t first = this->vertices.face[vertex];
+	uint32_t face = first;
+	do {
+		const auto& corners = this->mesh.faces[face];
+		unsigned int slot = corners[0] == vertex ? 0 : corners[1] == vertex ? 1 : 2;
+		ring.push_back(corners[(slot + 1) % 3]);
+		face = this->mesh.neighbours[face][slot];
+		if (face == Mesh::none || ring.size() > count) {
+			return false;
+		}
+	} while (face != first);
+	// Faces not reached through neighbours only touch vertex at a corner
+	if (ring.size() != count) {
+		return false;
+	}
+
+	// Only vertices with the ones around them above on one side and below on the other are spliced.
+	// Those are crossed by a single loop, the others start, end, split or join loops.
+	size_t changes = 0, below = 0;
+	uint32_t lower = none;
+	for (size_t i = 0; i < ring.size(); i++)
+	{
+		bool isAbove = above(ring[i]);
+		changes += isAbove != above(ring[(i + 1) % ring.size()]);
+		if (!isAbove) {
+			below++;
+			lower = ring[i];
+		}
+	}
+	if (changes != 2) {
+		return false;
+	}
+
+	// The nodes of the edges up to vertex are a run in the loop, drop them
+	auto found = this->nodeOf.find(key(lower, vertex));
+	if (found == this->nodeOf.end()) {
+		return false;
+	}
+	auto touches = [this, vertex](uint32_t node) {
+		return this->nodes[node].below == vertex || this->nodes[node].above == vertex;
+	};
+	uint32_t before = found->second;
+	for (size_t steps = 0; touches(before); steps++) {
+		if (steps > below) {
+			return false;
+		}
+		before = this->nodes[before].prev;
+	}
+	uint32_t after = this->nodes[before].next;
+	size_t run = 0;
+	for (; touches(after); run++) {
+		if (run == below || this->nodes[after].above != vertex) {
+			return false;
+		}
+		this->nodeOf.erase(key(this->nodes[after].below, vertex));
+		this->nodes[after].face = none;
+		this->unused.push_back(after);
+		after = this->nodes[after].next;
+	}
+	if (run != below) {
+		return false;
+	}
+
+	// Trace from the face of the node before the run to the face of the node after it, through the edges from vertex up
+	uint32_t last = before;
+	for (size_t steps = 0; ; steps++) {
+		if (steps > count) {
+			return false;
+		}
+		uint32_t current = this->nodes[last].face;
+		const auto& corners = this->mesh.faces[current];
+		unsigned int down = 3;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			if (above(corners[i]) && !above(corners[(i + 1) % 3])) {
+				down = i;
+			}
+		}
+		if (down == 3) {
+			return false;
+		}
+		uint32_t next = this->mesh.neighbours[current][down];
+		if (next == this->nodes[after].face) {
+			break;
+		}
+		uint32_t node = add(Node{ corners[(down + 1) % 3], corners[down], next, last, none });
+		if (!this->nodeOf.emplace(key(corners[(down + 1) % 3], corners[down]), node).second) {
+			return false;
+		}
+		this->nodes[last].next = node;
+		last = node;
+	}
+	this->nodes[last].next = after;
+	this->nodes[after].prev = last;
+	return true;
+}
+
+uint32_t ContourTracker::add(const Node& node)
+{
+	if (this->unused.empty()) {
+		this->nodes.push_back(node);
+		return static_cast<uint32_t>(this->nodes.size() - 1);
+	}
+	uint32_t index = this->unused.back();
+	this->unused.pop_back();
+	this->nodes[index] = node;
+	return index;
+}
+
+uint64_t ContourTracker::key(uint32_t below, uint32_t above)
+{
+	return static_cast<uint64_t>(below) << 32 | above;
+}
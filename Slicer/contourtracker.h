@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "mesh.h"
+#include "trianglesoa.h"
+
+class ContourTracker
+{
+	// Cross section of a closed mesh kept as loops of the mesh edges going up through the plane, for slicing layer after layer.
+	// Between mesh vertices the plane keeps crossing the same edges, so a new layer only moves the points along them.
+	// When the plane passes a vertex, the loop through the faces around it is spliced instead of tracing everything again.
+	// Vertices within FLOATERROR of the plane count as below it, and sections come out the same as from Object3D::traceContours.
+public:
+	struct Vertices {
+		// Built once for a slicing direction and shared by the trackers using it
+		Vertices(const Mesh& mesh, const Vector3d& direction);
+		std::vector<std::pair<float, uint32_t>> byDistance; // Distance along direction and vertex, ascending
+		std::vector<uint32_t> face; // A face around each vertex
+		std::vector<uint32_t> faces; // Number of faces around each vertex
+	};
+
+	// Vertices further than tolerance from a plane along the direction are taken to be on the side they appear to be
+	ContourTracker(const Mesh& mesh, const TriangleSoA& soa, const Vertices& vertices, float tolerance);
+
+	// Traces the loops from scratch, false if no face crosses the plane or the loops could not be traced
+	bool trace(const Plane& plane, const std::vector<unsigned int>& candidates);
+	// Moves the loops to a plane further along the direction. False if nothing is traced, or the plane passed a vertex
+	// the loops cannot be spliced around, like the top of a bump, or too many vertices to be worth splicing.
+	// The loops then have to be traced again.
+	bool advance(const Plane& plane);
+	// Section at the plane last traced or advanced to
+	template<typename Frame>
+	Polygon polygon(const Frame& frame) const;
+private:
+	struct Node {
+		uint32_t below, above; // Edge going up through the plane
+		uint32_t face; // Face the loop enters through the edge, none for unused nodes
+		uint32_t prev, next; // Nodes before and after in the loop
+	};
+	static constexpr uint32_t none = UINT32_MAX;
+
+	const Mesh& mesh;
+	const TriangleSoA& soa;
+	const Vertices& vertices;
+	float tolerance;
+
+	Plane plane;
+	bool axisAligned = false;
+	bool traced = false;
+	std::vector<Node> nodes;
+	std::vector<uint32_t> unused; // Nodes free for reuse
+	std::unordered_map<uint64_t, uint32_t> nodeOf; // Node of each edge, keyed by its vertices
+	size_t next = 0; // First vertex in byDistance not looked at yet
+	std::vector<uint32_t> pending; // Vertices looked at that were still above the plane
+	std::vector<bool> waiting; // Vertices the plane passed that are not spliced yet, still above as far as the loops go
+	std::vector<uint32_t> ring; // Scratch for splice
+
+	void moveTo(const Plane& plane);
+	float distance(uint32_t vertex) const;
+	bool above(uint32_t vertex) const;
+	bool splice(uint32_t vertex);
+	uint32_t add(const Node& node);
+	static uint64_t key(uint32_t below, uint32_t above);
+};
@@ -1,16 +1,55 @@
-#include <fstream>
+#include <algorithm>
+#include <bitset>
+#include <stdexcept>
 
 #include "gcode.h"
+#include "gcodewriter.h"
+#include "threadpool.h"
 
 
+Command::Command(char type, unsigned int number, std::initializer_list<std::pair<char, float>> parameters)
+	: type{ type }, number{ static_cast<uint16_t>(number) }
+{
+	for (const auto& [parameter, value] : parameters) {
+		if (parameter < 'A' || parameter > 'Z') {
+			throw std::invalid_argument(std::string("Not a G-code parameter: ") + parameter);
+		}
+		uint32_t bit = 1u << (parameter - 'A');
+		if (present & bit) {
+			continue;
+		}
+		// Values of the letters before this one come first
+		size_t count = std::bitset<26>(present).count();
+		if (count == capacity) {
+			throw std::logic_error("Too many parameters for a command");
+		}
+		size_t index = std::bitset<26>(present & (bit - 1)).count();
+		std::copy_backward(values.begin() + index, values.begin() + count, values.begin() + count + 1);
+		values[index] = value;
+		present |= bit;
+	}
+}
+
 Command Command::rapid(float F, float X, float Y) {
 	return Command{ 'G', 0, {{'F', F}, {'X', X}, {'Y', Y}} };
 }
 
+Command Command::rapidZ(float F, float Z) {
+	return Command{ 'G', 0, {{'F', F}, {'Z', Z}} };
+}
+
 Command Command::move(float E, float F, float X, float Y) {
 	return Command{ 'G', 1, {{'E', E}, {'F', F}, {'X', X}, {'Y', Y}} };
 }
 
+Command Command::arcClockwise(float E, float F, float I, float J, float X, float Y) {
+	return Command{ 'G', 2, {{'E', E}, {'F', F}, {'I', I}, {'J', J}, {'X', X}, {'Y', Y}} };
+}
+
+Command Command::arcCounterclockwise(float E, float F, float I, float J, float X, float Y) {
+	return Command{ 'G', 3, {{'E', E}, {'F', F}, {'I', I}, {'J', J}, {'X', X}, {'Y', Y}} };
+}
+
 Command Command::retract() {
 	return Command{ 'G', 10, {} };
 }
@@ -35,28 +74,181 @@ Command Command::fanOff() {
 	return Command{ 'M', 107, {} };
 }
 
+bool Command::is(char type, unsigned int number) const
+{
+	return this->type == type && this->number == number;
+}
+
+bool Command::has(char parameter) const
+{
+	return parameter >= 'A' && parameter <= 'Z' && (this->present & (1u << (parameter - 'A')));
+}
+
+float Command::operator[](char parameter) const
+{
+	if (!has(parameter)) {
+		throw std::out_of_range(std::string("Command has no parameter ") + parameter);
+	}
+	uint32_t bit = 1u << (parameter - 'A');
+	return this->values[std::bitset<26>(this->present & (bit - 1)).count()];
+}
 
 std::ostream& operator<<(std::ostream& out, const Command& c)
 {
 	out << c.type << c.number;
-	for (const auto& [parameter, value] : c.parameters) {
-		out << " " << parameter << value;
+	unsigned int index = 0;
+	for (unsigned int letter = 0; letter < 26; letter++) {
+		if (c.present & (1u << letter)) {
+			out << " " << static_cast<char>('A' + letter) << c.values[index++];
+		}
 	}
 	return out;
 }
 
+void BufferSink::push(const std::vector<Command>& commands)
+{
+	this->commands.insert(this->commands.end(), commands.cbegin(), commands.cend());
+}
+
+void NullSink::push(const std::vector<Command>& commands)
+{
+	this->count += commands.size();
+}
+
+GcodeGenerator::GcodeGenerator(const Machine& machine, const PrintSettings& settings)
+	: machine{ machine }, settings{ settings }
+{
+}
+
+std::vector<Command> GcodeGenerator::start()
+{
+	return { Command::extrusionAbsolute(), Command::resetCoordinate('E', 0.0f) };
+}
+
+std::vector<Command> GcodeGenerator::layer(const Polygon& layer)
+{
+	return this->layer(layer, ++layerNumber, extrusions(layer), extruded);
+}
+
+std::vector<float> GcodeGenerator::extrusions(const Polygon& layer) const
+{
+	float filamentArea = PI * machine.filamentDiameter * machine.filamentDiameter / 4;
+	float extrusionPerLength = machine.nozzleDiameter * settings.layerheight / filamentArea;
+
+	std::vector<float> result;
+	for (const auto& path : layer.paths) {
+		for (size_t i = 1; i <= path.vertices.size(); i++)
+		{
+			// Ends where it started to close the path
+			const Vector2d& previous = path.vertices[i - 1];
+			const Vector2d& vertex = path.vertices[i % path.vertices.size()];
+			result.push_back((vertex - previous).length() * extrusionPerLength);
+		}
+	}
+	return result;
+}
+
+std::vector<Command> GcodeGenerator::layer(const Polygon& layer, unsigned int number, const std::vector<float>& extrusions, float& extruded) const
+{
+	// Prints the perimeters of the layer
+	constexpr float perMinute = 60.0f;
+
+	std::vector<Command> commands;
+	if (number == 2) {
+		commands.push_back(Command::fanOn(255.0f));
+	}
+	commands.push_back(Command::rapidZ(settings.travelSpeed * perMinute, number * settings.layerheight));
+	auto extrusion = extrusions.cbegin();
+	for (const auto& path : layer.paths) {
+		if (path.vertices.empty()) {
+			continue;
+		}
+		const Vector2d& first = path.vertices.front();
+		commands.push_back(Command::retract());
+		commands.push_back(Command::rapid(settings.travelSpeed * perMinute, first[0] + settings.position[0], first[1] + settings.position[1]));
+		commands.push_back(Command::unRetract());
+		for (size_t i = 1; i <= path.vertices.size(); i++)
+		{
+			const Vector2d& vertex = path.vertices[i % path.vertices.size()];
+			extruded += *extrusion++;
+			commands.push_back(Command::move(extruded, settings.printSpeed * perMinute, vertex[0] + settings.position[0], vertex[1] + settings.position[1]));
+		}
+	}
+	return commands;
+}
+
+std::vector<Command> GcodeGenerator::end()
+{
+	return { Command::retract(), Command::fanOff() };
+}
+
 std::vector<Command> generateGcode(const std::vector<Polygon>& layers, const Machine& machine, const PrintSettings& settings)
 {
-	return std::vector<Command>();
+	BufferSink sink;
+	generateGcode(layers, machine, settings, sink);
+	return std::move(sink.commands);
 }
 
-void toFile(const std::vector<Command>& commands, const std::string& filename)
+void generateGcode(const std::vector<Polygon>& layers, const Machine& machine, const PrintSettings& settings, CommandSink& sink)
 {
-	std::ofstream file(filename);
-	if (!file) {
-		throw std::runtime_error("Could not open file " + filename);
+	GcodeGenerator generator(machine, settings);
+	sink.push(generator.start());
+	if (settings.threads == 1) {
+		for (const auto& layer : layers) {
+			sink.push(generator.layer(layer));
+		}
+	}
+	else {
+		// Only the absolute E of each layer depends on the layers below it. Summing the extrusions in print order
+		// gives the same E as printing layer by layer, and the commands of each layer are then generated in parallel.
+		// Layers are generated a batch at a time so only a batch of commands is held before it is pushed.
+		PoolHandle pool(settings.threads);
+		size_t batch = 4 * static_cast<size_t>(pool.size());
+		std::vector<std::vector<float>> extrusions(batch);
+		std::vector<float> startE(batch);
+		std::vector<std::vector<Command>> layerCommands(batch);
+		float extruded = 0.0f;
+		for (size_t begin = 0; begin < layers.size(); begin += batch) {
+			size_t count = std::min(batch, layers.size() - begin);
+			pool.parallelFor(count, [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; i++) {
+					extrusions[i] = generator.extrusions(layers[begin + i]);
+				}
+				});
+
+			for (size_t i = 0; i < count; i++) {
+				startE[i] = extruded;
+				for (float extrusion : extrusions[i]) {
+					extruded += extrusion;
+				}
+			}
+
+			pool.parallelFor(count, [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; i++) {
+					float layerE = startE[i];
+					layerCommands[i] = generator.layer(layers[begin + i], static_cast<unsigned int>(begin + i + 1), extrusions[i], layerE);
+				}
+				});
+
+			for (size_t i = 0; i < count; i++) {
+				sink.push(layerCommands[i]);
+			}
+		}
 	}
+	sink.push(generator.end());
+	sink.finish();
+}
+
+void toStream(const std::vector<Command>& commands, std::ostream& stream)
+{
 	for (const auto& command : commands) {
-		file << command << '\n';
+		stream << command << '\n';
 	}
 }
+
+void toFile(const std::vector<Command>& commands, const std::string& filename)
+{
+	GcodeWriter writer(filename);
+	writer.write(commands);
+	writer.flush();
+}
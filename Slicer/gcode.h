@@ -1,6 +1,10 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "geometry.h"
@@ -8,15 +12,21 @@
 
 class Command {
 private:
+	// Parameters are stored inline in letter order, with a bit for each letter present, so commands do not allocate
+	static constexpr unsigned int capacity = 6;
 	char type;
-	unsigned int number;
-	std::map<char, float> parameters;
-	Command(char type, unsigned int number, const std::map<char, float>& parameters)
-		: type{ type }, number{ number }, parameters{ parameters } {}
+	uint16_t number;
+	uint32_t present = 0; // Bit i is set if the command has parameter 'A' + i
+	std::array<float, capacity> values{};
+	Command(char type, unsigned int number, std::initializer_list<std::pair<char, float>> parameters);
 public:
 	Command() = delete;
 	static Command rapid(float F, float X, float Y);
+	static Command rapidZ(float F, float Z);
 	static Command move(float E, float F, float X, float Y);
+	// Arcs to X, Y around the centre at I, J from the current position
+	static Command arcClockwise(float E, float F, float I, float J, float X, float Y);
+	static Command arcCounterclockwise(float E, float F, float I, float J, float X, float Y);
 	static Command retract();
 	static Command unRetract();
 	static Command resetCoordinate(char coord, float value);
@@ -24,9 +34,64 @@ public:
 	static Command fanOn(float S);
 	static Command fanOff();
 
+	bool is(char type, unsigned int number) const;
+	bool has(char parameter) const;
+	// Value of a parameter, throws std::out_of_range if the command does not have it, so check has() first
+	float operator[](char parameter) const;
+
 	friend std::ostream& operator<<(std::ostream& os, const Command& command);
+	friend class GcodeFormatter;
+};
+
+
+class CommandSink {
+	// Takes the commands of a print as they are generated, a layer at a time
+public:
+	virtual ~CommandSink() = default;
+	virtual void push(const std::vector<Command>& commands) = 0;
+	// Called after the last commands of the print
+	virtual void finish() {}
+};
+
+class BufferSink : public CommandSink {
+	// Keeps the commands in memory
+public:
+	void push(const std::vector<Command>& commands) override;
+	std::vector<Command> commands;
 };
 
+class NullSink : public CommandSink {
+	// Only counts the commands
+public:
+	void push(const std::vector<Command>& commands) override;
+	size_t count = 0;
+};
+
+
+class GcodeGenerator {
+	// Turns layers into commands one layer at a time, so layers can be freed as soon as they are printed
+public:
+	GcodeGenerator(const Machine& machine, const PrintSettings& settings);
+	std::vector<Command> start();
+	// Layers must be given in order, starting from the bottom
+	std::vector<Command> layer(const Polygon& layer);
+	std::vector<Command> end();
+
+	// Filament extruded along each printed segment of a layer
+	std::vector<float> extrusions(const Polygon& layer) const;
+	// Commands for the given layer starting at absolute E extruded, leaves extruded at the end of the layer.
+	// Does not touch the generator, so layers can be generated in parallel once their starting E is known.
+	std::vector<Command> layer(const Polygon& layer, unsigned int number, const std::vector<float>& extrusions, float& extruded) const;
+private:
+	const Machine& machine;
+	const PrintSettings& settings;
+	unsigned int layerNumber = 0;
+	float extruded = 0.0f; // Absolute E
+};
 
 std::vector<Command> generateGcode(const std::vector<Polygon>& layers, const Machine& machine, const PrintSettings& settings);
+// Pushes the commands into sink as each layer is generated, then finishes it. Holds the commands of a few layers per thread at most.
+void generateGcode(const std::vector<Polygon>& layers, const Machine& machine, const PrintSettings& settings, CommandSink& sink);
+void toStream(const std::vector<Command>& commands, std::ostream& stream);
+// Writes through GcodeWriter, in its format rather than operator<<
 void toFile(const std::vector<Command>& commands, const std::string& filename);
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "gcodewriter.h"
+
+namespace {
+	constexpr std::array<int64_t, 6> powersOfTen{ 1, 10, 100, 1000, 10000, 100000 };
+
+	uint32_t bit(char parameter)
+	{
+		return 1u << (parameter - 'A');
+	}
+
+	// Value in units of its last decimal
+	int64_t toUnits(char parameter, float value, unsigned int decimals)
+	{
+		// llround is undefined for NaN and for results outside int64_t
+		double scaled = static_cast<double>(value) * powersOfTen[decimals];
+		if (!std::isfinite(scaled) || std::abs(scaled) >= 9.2e18) {
+			throw std::out_of_range(std::string("G-code parameter ") + parameter + " out of range: " + std::to_string(value));
+		}
+		return std::llround(scaled);
+	}
+
+	// Writes value given in units of its last decimal, without trailing zeros
+	char* writeFixed(char* out, char* end, int64_t value, unsigned int decimals)
+	{
+		// Negated as unsigned, as -value overflows for the smallest int64_t
+		uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+		if (value < 0) {
+			*out++ = '-';
+		}
+		uint64_t scale = powersOfTen[decimals];
+		out = std::to_chars(out, end, magnitude / scale).ptr;
+		uint64_t fraction = magnitude % scale;
+		if (fraction == 0) {
+			return out;
+		}
+		while (fraction % 10 == 0) {
+			fraction /= 10;
+			decimals--;
+		}
+		*out++ = '.';
+		char* digits = out;
+		out = std::to_chars(out, end, fraction).ptr;
+		// Leading zeros of the fraction
+		size_t padding = decimals - (out - digits);
+		if (padding > 0) {
+			std::copy_backward(digits, out, out + padding);
+			std::fill(digits, digits + padding, '0');
+			out += padding;
+		}
+		return out;
+	}
+}
+
+unsigned int GcodeFormatter::decimals(char parameter)
+{
+	return parameter == 'E' ? 5 : 3;
+}
+
+char* GcodeFormatter::format(const Command& command, char* out)
+{
+	char* end = out + maxLength;
+	*out++ = command.type;
+	out = std::to_chars(out, end, command.number).ptr;
+
+	// Coordinates and feed rate stay as the last move left them, a G92 only sets the coordinates it gives
+	bool move = isMove(command);
+	bool sets = setsPosition(command);
+
+	unsigned int index = 0;
+	for (char parameter = 'A'; parameter <= 'Z'; parameter++) {
+		uint32_t flag = bit(parameter);
+		if (!(command.present & flag)) {
+			continue;
+		}
+		unsigned int places = decimals(parameter);
+		int64_t value = toUnits(parameter, command.values[index++], places);
+		if (move && (this->known & flag) && this->last[parameter - 'A'] == value) {
+			continue;
+		}
+		if (sets && (modal & flag)) {
+			this->known |= flag;
+			this->last[parameter - 'A'] = value;
+		}
+		*out++ = ' ';
+		*out++ = parameter;
+		out = writeFixed(out, end, value, places);
+	}
+	*out++ = '\n';
+	return out;
+}
+
+size_t GcodeFormatter::format(const std::vector<Command>& commands, std::vector<char>& text, size_t used)
+{
+	for (const auto& command : commands) {
+		if (text.size() - used < maxLength) {
+			text.resize(std::max(2 * text.size(), 64 * maxLength));
+		}
+		char* start = text.data() + used;
+		used += format(command, start) - start;
+	}
+	return used;
+}
+
+void GcodeFormatter::skip(const std::vector<Command>& commands)
+{
+	// Only the last value given to each parameter matters, so look back from the end until each one is found
+	uint32_t found = 0;
+	for (auto command = commands.crbegin(); command != commands.crend() && found != modal; ++command) {
+		if (!setsPosition(*command)) {
+			continue;
+		}
+		unsigned int index = 0;
+		for (char parameter = 'A'; parameter <= 'Z'; parameter++) {
+			uint32_t flag = bit(parameter);
+			if (!(command->present & flag)) {
+				continue;
+			}
+			float value = command->values[index++];
+			if ((modal & flag) && !(found & flag)) {
+				found |= flag;
+				this->known |= flag;
+				this->last[parameter - 'A'] = toUnits(parameter, value, decimals(parameter));
+			}
+		}
+	}
+}
+
+void GcodeFormatter::reset()
+{
+	this->known = 0;
+}
+
+bool GcodeFormatter::isMove(const Command& command)
+{
+	return command.type == 'G' && command.number <= 3;
+}
+
+bool GcodeFormatter::setsPosition(const Command& command)
+{
+	return isMove(command) || (command.type == 'G' && command.number == 92);
+}
+
+GcodeWriter::GcodeWriter(const std::string& filename, size_t bufferSize)
+	: filename{ filename }, file(filename, std::ios::binary), buffer(std::max(bufferSize, 2 * GcodeFormatter::maxLength))
+{
+	if (!this->file) {
+		throw std::runtime_error("Could not open file " + filename);
+	}
+}
+
+GcodeWriter::~GcodeWriter()
+{
+	try {
+		flush();
+	}
+	catch (...) {}
+}
+
+void GcodeWriter::write(const Command& command)
+{
+	if (this->buffer.size() - this->used < GcodeFormatter::maxLength) {
+		flush();
+	}
+	char* start = this->buffer.data() + this->used;
+	this->used += this->formatter.format(command, start) - start;
+}
+
+void GcodeWriter::write(const std::vector<Command>& commands)
+{
+	for (const auto& command : commands) {
+		write(command);
+	}
+}
+
+void GcodeWriter::write(const char* text, size_t size)
+{
+	if (this->buffer.size() - this->used < size) {
+		flush();
+	}
+	if (size >= this->buffer.size()) {
+		this->file.write(text, size);
+		return;
+	}
+	std::copy(text, text + size, this->buffer.data() + this->used);
+	this->used += size;
+}
+
+void GcodeWriter::flush()
+{
+	if (this->used > 0) {
+		this->file.write(this->buffer.data(), this->used);
+		this->used = 0;
+	}
+	this->file.flush();
+	if (!this->file) {
+		throw std::runtime_error("Could not write to file " + this->filename);
+	}
+}
+
+FileSink::FileSink(const std::string& filename, size_t bufferSize)
+	: writer(filename, bufferSize)
+{
+}
+
+void FileSink::push(const std::vector<Command>& commands)
+{
+	this->writer.write(commands);
+}
+
+void FileSink::finish()
+{
+	this->writer.flush();
+}
+
+ParallelFileSink::ParallelFileSink(const std::string& filename, unsigned int threads, size_t bufferSize)
+	: pool(threads), writer(filename, bufferSize)
+{
+	this->chunks.resize(4 * static_cast<size_t>(this->pool.size()));
+}
+
+void ParallelFileSink::push(const std::vector<Command>& commands)
+{
+	Chunk& chunk = this->chunks[this->pending++];
+	chunk.commands = commands;
+	chunk.formatter = this->formatter;
+	this->formatter.skip(commands);
+	if (this->pending == this->chunks.size()) {
+		writeChunks();
+	}
+}
+
+void ParallelFileSink::finish()
+{
+	writeChunks();
+	this->writer.flush();
+}
+
+void ParallelFileSink::writeChunks()
+{
+	this->pool.parallelFor(this->pending, [this](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			Chunk& chunk = this->chunks[i];
+			chunk.used = chunk.formatter.format(chunk.commands, chunk.text, 0);
+		}
+		}, 1);
+	// The texts go out in the order the layers were pushed
+	for (size_t i = 0; i < this->pending; i++) {
+		this->writer.write(this->chunks[i].text.data(), this->chunks[i].used);
+	}
+	this->pending = 0;
+}
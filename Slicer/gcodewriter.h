@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gcode.h"
+#include "threadpool.h"
+
+class GcodeFormatter {
+	// Formats commands as G-code text with a fixed number of decimals per parameter.
+	// Remembers where moves left the machine, and leaves out the coordinates and feed rate a move does not change.
+public:
+	// Longest line format can write
+	static constexpr size_t maxLength = 256;
+	// Decimals written for a parameter, trailing zeros are dropped
+	static unsigned int decimals(char parameter);
+
+	// Writes the command and a newline at out, which must have room for maxLength characters. Returns the end of the line.
+	// Throws std::out_of_range for values that are not finite or too large to write with their decimals.
+	char* format(const Command& command, char* out);
+	// Appends the commands to text from used on, growing it as needed. Returns the new used.
+	size_t format(const std::vector<Command>& commands, std::vector<char>& text, size_t used);
+	// Moves past commands without formatting them, as formatting them would
+	void skip(const std::vector<Command>& commands);
+	// Forgets where the machine is, the next moves give all their parameters
+	void reset();
+private:
+	// Parameters that keep their value from move to move
+	static constexpr uint32_t modal = (1u << ('E' - 'A')) | (1u << ('F' - 'A')) | (1u << ('X' - 'A')) | (1u << ('Y' - 'A')) | (1u << ('Z' - 'A'));
+	static bool isMove(const Command& command);
+	static bool setsPosition(const Command& command);
+
+	uint32_t known = 0; // Bit i is set if the value of parameter 'A' + i is known
+	std::array<int64_t, 26> last{}; // Last value of each parameter, in units of its last decimal
+};
+
+class GcodeWriter {
+	// Writes G-code to a file through a large buffer, so the file sees few large writes
+public:
+	static constexpr size_t defaultBufferSize = 4 << 20;
+
+	explicit GcodeWriter(const std::string& filename, size_t bufferSize = defaultBufferSize);
+	GcodeWriter(const GcodeWriter&) = delete;
+	GcodeWriter& operator=(const GcodeWriter&) = delete;
+	// Writes out what is left in the buffer, call flush first to see errors
+	~GcodeWriter();
+
+	void write(const Command& command);
+	void write(const std::vector<Command>& commands);
+	// Text already formatted, the commands in it are not followed by the formatter of the writer
+	void write(const char* text, size_t size);
+	// Writes out the buffer, throws if the file could not be written
+	void flush();
+private:
+	std::string filename;
+	std::ofstream file;
+	std::vector<char> buffer;
+	size_t used = 0;
+	GcodeFormatter formatter;
+};
+
+class FileSink : public CommandSink {
+	// Writes the commands to a G-code file through a GcodeWriter
+public:
+	explicit FileSink(const std::string& filename, size_t bufferSize = GcodeWriter::defaultBufferSize);
+	void push(const std::vector<Command>& commands) override;
+	// Writes out the buffer, throws if the file could not be written
+	void finish() override;
+private:
+	GcodeWriter writer;
+};
+
+class ParallelFileSink : public CommandSink {
+	// Formats the pushed layers on a pool, each into a text of its own, and writes the texts to the file in the order
+	// they were pushed. Where moves leave the machine is followed as layers are pushed, so each layer is formatted
+	// without the layers before it, and the file comes out the same as from FileSink.
+public:
+	ParallelFileSink(const std::string& filename, unsigned int threads, size_t bufferSize = GcodeWriter::defaultBufferSize);
+	void push(const std::vector<Command>& commands) override;
+	// Writes out the layers left, throws if the file could not be written
+	void finish() override;
+private:
+	struct Chunk {
+		std::vector<Command> commands;
+		GcodeFormatter formatter; // As the layers before left it
+		std::vector<char> text;
+		size_t used = 0; // Characters of text formatted
+	};
+
+	PoolHandle pool;
+	GcodeWriter writer;
+	GcodeFormatter formatter; // As the layers pushed so far left it
+	std::vector<Chunk> chunks; // A window of layers formatted at a time
+	size_t pending = 0; // Chunks pushed and not written yet
+
+	void writeChunks();
+};
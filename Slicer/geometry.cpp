@@ -53,7 +53,7 @@ std::array<Edge3d, 2> getIntersectingEdges(const std::array<int, 3>& positions,
 	return edges;
 }
 
-std::vector<Edge3d> intersection(const Plane& plane, const Triangle3d& triangle)
+void intersection(const Plane& plane, const Triangle3d& triangle, std::pmr::vector<Edge3d>& edges)
 {
 	// Assumes triangle intersects plane
 	std::array<int, 3> position = vertexPositions(plane, triangle);
@@ -72,8 +72,6 @@ std::vector<Edge3d> intersection(const Plane& plane, const Triangle3d& triangle)
 		assert(false); // At least one edge should be in plane
 	};
 
-	std::vector<Edge3d> edges;
-
 	switch (numberOfVerticesInPlane)
 	{
 	case 0: {
@@ -107,14 +105,13 @@ std::vector<Edge3d> intersection(const Plane& plane, const Triangle3d& triangle)
 		// Make three edges, one for each edge in triangle
 		for (unsigned int i = 0; i < 3; i++)
 		{
-			edges.emplace_back(Edge3d{ triangle.vertices[i], triangle.vertices[(i + 1) % 3] });
+			edges.emplace_back(Edge3d{ triangle.vertices[i], triangle.vertices[(i + 1) % 3], Vector3d{ 0, 0, 0 } });
 		}
 		break;
 	}
 	default:
 		throw std::logic_error("A triangle cannot have more than 3 vertices.");
 	}
-	return edges;
 }
 
 float project(const Vector3d& base, const Vector3d& vector) {
@@ -132,6 +129,32 @@ Edge2d project(const Plane& plane, const Edge3d& edge)
 	return Edge2d{ project(plane, edge.start), project(plane, edge.end), project(plane, edge.normal) };
 }
 
+bool isAxisAligned(const Plane& plane)
+{
+	return plane.normal[0] == 0.0f && plane.normal[1] == 0.0f && plane.normal[2] == 1.0f
+		&& plane.xAxis[0] == 1.0f && plane.xAxis[1] == 0.0f && plane.xAxis[2] == 0.0f;
+}
+
+
+int64_t cross(const Vector2i& lhs, const Vector2i& rhs)
+{
+	return lhs[0] * rhs[1] - lhs[1] * rhs[0];
+}
+
+Polygon toPolygon(const FixedPointGrid& grid, const FixedPolygon& polygon)
+{
+	Polygon result;
+	result.paths.reserve(polygon.paths.size());
+	for (const auto& path : polygon.paths) {
+		SimplePolygon simple;
+		simple.vertices.reserve(path.vertices.size());
+		for (const auto& vertex : path.vertices) {
+			simple.vertices.push_back(grid.point(vertex));
+		}
+		result.paths.push_back(std::move(simple));
+	}
+	return result;
+}
 
 std::vector<Triangle3d>withVertex(const std::vector<Triangle3d>& triangles, const Vector3d& vertex)
 {
@@ -1,5 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <functional>
+#include <memory_resource>
 #include <vector>
 
 #include "vector.h"
@@ -56,14 +60,102 @@ struct Polygon {
 	std::vector<SimplePolygon> paths;
 };
 
+// Moves the path with the rightmost vertex to the front, as that path is the outer one
+template<typename Path>
+void rightmostFirst(std::vector<Path>& paths)
+{
+	auto rightmost = [](const Path& path) {
+		return std::max_element(path.vertices.cbegin(), path.vertices.cend(), [](const auto& lhs, const auto& rhs) {
+			return lhs[0] < rhs[0];
+			})->operator[](0);
+	};
+	auto outer = std::max_element(paths.begin(), paths.end(), [&rightmost](const Path& lhs, const Path& rhs) {
+		return rightmost(lhs) < rightmost(rhs);
+		});
+	if (outer != paths.end()) {
+		std::iter_swap(paths.begin(), outer);
+	}
+}
+
+class FixedPointGrid {
+	// Snaps points onto a grid of integer coordinates resolution apart, where equal points compare and hash exactly
+	// and cross products are exact. At the default resolution of 1 nm, coordinates up to a meter from the origin
+	// keep cross products of differences within int64_t.
+public:
+	explicit FixedPointGrid(double resolution = 1e-6) : resolution{ resolution } {}
+	Vector2i snap(const Vector2d& point) const {
+		return { std::llround(point[0] / resolution), std::llround(point[1] / resolution) };
+	}
+	Vector2d point(const Vector2i& point) const {
+		return { static_cast<float>(point[0] * resolution), static_cast<float>(point[1] * resolution) };
+	}
+	double resolution; // In millimeters
+};
+
+struct FixedSimplePolygon {
+	// SimplePolygon with vertices on a FixedPointGrid
+	std::vector<Vector2i> vertices;
+};
+
+struct FixedPolygon {
+	// Polygon with vertices on a FixedPointGrid, first path outermost
+	std::vector<FixedSimplePolygon> paths;
+};
+
+struct FixedPointHash {
+	size_t operator()(const Vector2i& point) const {
+		return std::hash<int64_t>()(point[0] * 73856093 ^ point[1] * 19349663);
+	}
+};
+
+// Exact 2D cross product, positive if rhs turns counterclockwise from lhs
+int64_t cross(const Vector2i& lhs, const Vector2i& rhs);
+Polygon toPolygon(const FixedPointGrid& grid, const FixedPolygon& polygon);
+
+float planeCosine(const Plane& plane, const Vector3d& vertex);
+bool aboveOrBelow(const Plane& plane, const Triangle3d& triangle);
 std::vector<Triangle3d> intersects(const std::vector<Triangle3d>& triangles, const Plane& plane);
 Vector3d intersection(const Plane& plane, const Line& line);
 Vector2d intersection(const Line& lhs, const Line& rhs);
-std::vector<Edge3d> intersection(const Plane& plane, const Triangle3d& triangle);
+// Appends the edges where triangle meets plane
+void intersection(const Plane& plane, const Triangle3d& triangle, std::pmr::vector<Edge3d>& edges);
 
 Vector2d project(const Plane& plane, const Vector3d& vector);
 Edge2d project(const Plane& plane, const Edge3d& edge);
 
+// True if plane has normal (0, 0, 1) and x axis (1, 0, 0), so AxisAlignedFrame can be used for it
+bool isAxisAligned(const Plane& plane);
+
+class GeneralFrame {
+	// Projects into any plane, with the y axis worked out once instead of for every point
+public:
+	explicit GeneralFrame(const Plane& plane)
+		: point{ plane.point }, xAxis{ plane.xAxis }, yAxis{ plane.yAxis() }, xLength{ plane.xAxis.length() }, yLength{ yAxis.length() } {}
+	Vector2d project(const Vector3d& vector) const {
+		Vector3d shifted = vector - point;
+		return { xAxis.dot(shifted) / xLength, yAxis.dot(shifted) / yLength };
+	}
+private:
+	Vector3d point, xAxis, yAxis;
+	float xLength, yLength;
+};
+
+class AxisAlignedFrame {
+	// Projects into a plane for which isAxisAligned is true by dropping z, giving the same result as GeneralFrame
+public:
+	explicit AxisAlignedFrame(const Plane& plane) : point{ plane.point } {}
+	Vector2d project(const Vector3d& vector) const {
+		return { vector[0] - point[0], vector[1] - point[1] };
+	}
+private:
+	Vector3d point;
+};
+
+template<typename Frame>
+Edge2d project(const Frame& frame, const Edge3d& edge) {
+	return Edge2d{ frame.project(edge.start), frame.project(edge.end), frame.project(edge.normal) };
+}
+
 std::vector<Triangle3d> withVertex(const std::vector<Triangle3d>& triangles, const Vector3d& vertex);
 Triangle3d withEdge(const std::vector<Triangle3d>& triangles, const Vector3d& firstVertex, const Vector3d& secondVertex);
 Triangle3d withEdge(const std::vector<Triangle3d>& withVertex, const Vector3d& secondVertex);
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cmath>
+
+#include "intervaltree.h"
+
+IntervalTree::IntervalTree(const std::vector<std::pair<float, float>>& extents)
+{
+	nodes.reserve(extents.size());
+	for (unsigned int i = 0; i < extents.size(); i++)
+	{
+		nodes.push_back({ extents[i].first, extents[i].second, extents[i].second, i });
+	}
+	std::sort(nodes.begin(), nodes.end(), [](const Node& lhs, const Node& rhs) {
+		return lhs.start < rhs.start;
+		});
+	build(0, nodes.size());
+}
+
+IntervalTree::IntervalTree(const std::vector<std::pair<float, float>>& extents, const std::vector<unsigned int>& order)
+{
+	nodes.reserve(order.size());
+	for (unsigned int i : order)
+	{
+		nodes.push_back({ extents[i].first, extents[i].second, extents[i].second, i });
+	}
+	build(0, nodes.size());
+}
+
+float IntervalTree::build(size_t begin, size_t end)
+{
+	if (begin == end) {
+		return -INFINITY;
+	}
+	size_t middle = begin + (end - begin) / 2;
+	Node& root = nodes[middle];
+	root.maxEnd = std::max({ root.end, build(begin, middle), build(middle + 1, end) });
+	return root.maxEnd;
+}
+
+std::vector<unsigned int> IntervalTree::stab(float point, float tolerance) const
+{
+	float low = point - tolerance, high = point + tolerance;
+	std::vector<unsigned int> result;
+
+	// Ranges left to search, the tree is only log n deep
+	std::vector<std::pair<size_t, size_t>> ranges{ {0, nodes.size()} };
+	while (!ranges.empty()) {
+		auto [begin, end] = ranges.back();
+		ranges.pop_back();
+		if (begin == end) {
+			continue;
+		}
+		size_t middle = begin + (end - begin) / 2;
+		const Node& root = nodes[middle];
+		if (root.maxEnd < low) {
+			// Every interval in the range ends before the point
+			continue;
+		}
+		ranges.emplace_back(begin, middle);
+		if (root.start <= high) {
+			if (root.end >= low) {
+				result.push_back(root.index);
+			}
+			// Intervals to the right start after the root, so only worth searching if the root does not start past the point
+			ranges.emplace_back(middle + 1, end);
+		}
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+size_t IntervalTree::size() const
+{
+	return nodes.size();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <utility>
+#include <vector>
+
+class IntervalTree
+{
+	// Static interval tree finding the k intervals containing a point in O(k log n), at worst.
+	// Intervals are sorted by their start and stored as an implicit balanced tree,
+	// where the middle of each range is the root of that range.
+	// Each root also keeps the highest end in its range, so ranges ending below the point are skipped.
+	// A range that is not skipped may still hold no match, so each match can cost a path of O(log n) nodes.
+public:
+	IntervalTree() = default;
+	// Interval i is extents[i], as lowest and highest value
+	explicit IntervalTree(const std::vector<std::pair<float, float>>& extents);
+	// Same as above for order holding the indices of extents sorted by lowest value, without sorting them again
+	IntervalTree(const std::vector<std::pair<float, float>>& extents, const std::vector<unsigned int>& order);
+
+	// Indices of the intervals within tolerance of point, in ascending order
+	std::vector<unsigned int> stab(float point, float tolerance = 0.0f) const;
+	size_t size() const;
+private:
+	struct Node {
+		float start, end;
+		float maxEnd; // Highest end in the range this node is the root of
+		unsigned int index;
+	};
+	std::vector<Node> nodes;
+
+	float build(size_t begin, size_t end);
+};
@@ -23,22 +23,25 @@ int main() {
 	
 	//Object3D obj;
 	//string filename = "cube_bin";
-	//obj.fromFile("stl/" + filename +".stl", true);
+	//obj.fromFile("stl/" + filename +".stl", true, s.threads);
 	//
 	//Plane plane(Vector3d(s.position), s.direction, s.tangent);
-	//std::vector<Polygon> slices = obj.slice(plane, s.layerheight);
-	//for (int i = 0; i < slices.size(); ++i) {
+	//std::ofstream gcode("gcode/" + filename + ".gcode");
+	//GcodeGenerator generator(m, s);
+	//toStream(generator.start(), gcode);
+	//int i = 0;
+	//obj.slice(plane, s.layerheight, [&](Polygon&& layer) {
 	//	cout << i << ": ";
-	//	for (int j = 0; j < slices[i].paths.size(); j++) {
-	//		cout << slices[i].paths[j].vertices.size() << " ";
+	//	for (int j = 0; j < layer.paths.size(); j++) {
+	//		cout << layer.paths[j].vertices.size() << " ";
 	//	}
 	//	cout << endl;
 	//	std::stringstream ss;
-	//	ss << std::setw(4) << std::setfill('0') << i;
-	//	saveAsSVG(slices[i], "svg/" + ss.str() + ".svg", 1);
-	//}
-	//
-	//toFile(generateGcode(slices, m, s), "gcode/" + filename + ".gcode");
+	//	ss << std::setw(4) << std::setfill('0') << i++;
+	//	saveAsSVG(layer, "svg/" + ss.str() + ".svg", 1);
+	//	toStream(generator.layer(layer), gcode);
+	//}, s.threads);
+	//toStream(generator.end(), gcode);
 
 	
 	
@@ -0,0 +1,110 @@
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename)
+{
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error("Could not open file " + filename);
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		throw std::runtime_error("Could not read size of file " + filename);
+	}
+	length = static_cast<size_t>(fileSize.QuadPart);
+	if (length == 0) {
+		// Empty files cannot be mapped
+		return;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping) {
+		view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (!view) {
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		throw std::runtime_error("Could not map file " + filename);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (view) {
+		UnmapViewOfFile(view);
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	if (file) {
+		CloseHandle(file);
+	}
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename)
+{
+	descriptor = open(filename.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		throw std::runtime_error("Could not open file " + filename);
+	}
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0) {
+		close(descriptor);
+		throw std::runtime_error("Could not read size of file " + filename);
+	}
+	length = static_cast<size_t>(status.st_size);
+	if (length == 0) {
+		// Empty files cannot be mapped
+		return;
+	}
+
+	void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (mapped == MAP_FAILED) {
+		close(descriptor);
+		throw std::runtime_error("Could not map file " + filename);
+	}
+	madvise(mapped, length, MADV_SEQUENTIAL);
+	view = static_cast<const char*>(mapped);
+}
+
+MappedFile::~MappedFile()
+{
+	if (view) {
+		munmap(const_cast<char*>(view), length);
+	}
+	close(descriptor);
+}
+
+#endif
+
+const char* MappedFile::data() const
+{
+	return view;
+}
+
+size_t MappedFile::size() const
+{
+	return length;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+
+class MappedFile
+{
+	// Read-only view of a whole file mapped into memory
+public:
+	explicit MappedFile(const std::string& filename);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const;
+	size_t size() const;
+private:
+	const char* view = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int descriptor = -1;
+#endif
+};
@@ -0,0 +1,150 @@
+#include <cmath>
+#include <unordered_map>
+
+#include "mesh.h"
+
+struct Cell {
+	int64_t x, y, z;
+
+	bool operator==(const Cell& rhs) const {
+		return x == rhs.x && y == rhs.y && z == rhs.z;
+	}
+};
+
+struct CellHash {
+	size_t operator()(const Cell& cell) const {
+		return static_cast<size_t>(cell.x * 73856093) ^ static_cast<size_t>(cell.y * 19349663) ^ static_cast<size_t>(cell.z * 83492791);
+	}
+};
+
+void Mesh::add(const std::vector<Triangle3d>& triangles, float tolerance)
+{
+	// Vertices are hashed into cells twice as wide as the tolerance, so a vertex only
+	// has to search the 8 cells nearest to it for a vertex to merge with
+	const float cellSize = 2 * tolerance;
+	std::unordered_map<Cell, uint32_t, CellHash> first; // First vertex in each cell
+	std::vector<uint32_t> next; // Next vertex in the same cell, or none
+	constexpr uint32_t none = UINT32_MAX;
+	first.reserve(vertices.size() + triangles.size());
+	next.reserve(vertices.size() + triangles.size());
+
+	auto cellOf = [cellSize](const Vector3d& vertex) {
+		return Cell{
+			static_cast<int64_t>(std::floor(vertex[0] / cellSize)),
+			static_cast<int64_t>(std::floor(vertex[1] / cellSize)),
+			static_cast<int64_t>(std::floor(vertex[2] / cellSize)) };
+	};
+
+	auto insert = [&](uint32_t index) {
+		auto [it, inserted] = first.try_emplace(cellOf(vertices[index]), index);
+		next.push_back(inserted ? none : it->second);
+		it->second = index;
+	};
+
+	auto find = [&](const Vector3d& vertex) {
+		// Search own cell first, then the neighbouring cells on the sides vertex is closest to
+		Cell cell = cellOf(vertex);
+		int64_t step[3];
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			float scaled = vertex[axis] / cellSize;
+			step[axis] = scaled - std::floor(scaled) < 0.5f ? -1 : 1;
+		}
+		for (unsigned int neighbour = 0; neighbour < 8; neighbour++)
+		{
+			Cell search{
+				cell.x + (neighbour & 1 ? step[0] : 0),
+				cell.y + (neighbour & 2 ? step[1] : 0),
+				cell.z + (neighbour & 4 ? step[2] : 0) };
+			auto it = first.find(search);
+			if (it == first.end()) {
+				continue;
+			}
+			for (uint32_t index = it->second; index != none; index = next[index]) {
+				if (vertices[index].isClose(vertex, tolerance)) {
+					return index;
+				}
+			}
+		}
+
+		uint32_t index = static_cast<uint32_t>(vertices.size());
+		vertices.push_back(vertex);
+		insert(index);
+		return index;
+	};
+
+	for (uint32_t i = 0; i < vertices.size(); i++)
+	{
+		insert(i);
+	}
+
+	faces.reserve(faces.size() + triangles.size());
+	for (const auto& triangle : triangles) {
+		std::array<uint32_t, 3> face{ find(triangle.vertices[0]), find(triangle.vertices[1]), find(triangle.vertices[2]) };
+		if (face[0] != face[1] && face[1] != face[2] && face[2] != face[0]) {
+			faces.push_back(face);
+		}
+	}
+
+	connect();
+}
+
+void Mesh::connect()
+{
+	// Each directed edge is owned by the face it belongs to. Its neighbour is the owner of the
+	// reversed edge, which only exists once if the surface is manifold and consistently wound.
+	auto key = [](uint32_t from, uint32_t to) {
+		return static_cast<uint64_t>(from) << 32 | to;
+	};
+	constexpr uint32_t ambiguous = none - 1;
+	std::unordered_map<uint64_t, uint32_t> owners;
+	owners.reserve(faces.size() * 3);
+	for (uint32_t face = 0; face < faces.size(); face++)
+	{
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			auto [it, inserted] = owners.try_emplace(key(faces[face][i], faces[face][(i + 1) % 3]), face);
+			if (!inserted) {
+				it->second = ambiguous;
+			}
+		}
+	}
+
+	isClosed = true;
+	neighbours.assign(faces.size(), { none, none, none });
+	for (uint32_t face = 0; face < faces.size(); face++)
+	{
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			uint32_t from = faces[face][i], to = faces[face][(i + 1) % 3];
+			auto it = owners.find(key(to, from));
+			if (it != owners.end() && it->second != ambiguous && owners[key(from, to)] != ambiguous) {
+				neighbours[face][i] = it->second;
+			}
+			else {
+				isClosed = false;
+			}
+		}
+	}
+}
+
+Triangle3d Mesh::triangle(size_t face) const
+{
+	Triangle3d triangle;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		triangle.vertices[i] = vertices[faces[face][i]];
+	}
+	triangle.normal = cross(triangle.vertices[1] - triangle.vertices[0], triangle.vertices[2] - triangle.vertices[0]).normalized();
+	return triangle;
+}
+
+size_t Mesh::size() const
+{
+	return faces.size();
+}
+
+bool Mesh::closed() const
+{
+	return isClosed;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "geometry.h"
+
+class Mesh
+{
+	// Triangles stored as indices into a shared vertex buffer
+public:
+	std::vector<Vector3d> vertices;
+	std::vector<std::array<uint32_t, 3>> faces;
+	// Face across each edge of a face, edge i goes from vertex i to vertex i + 1.
+	// Edges without exactly one oppositely wound neighbour have none.
+	std::vector<std::array<uint32_t, 3>> neighbours;
+	static constexpr uint32_t none = UINT32_MAX;
+
+	// Appends triangles, merging vertices closer than tolerance to each other.
+	// Triangles that collapse when their vertices are merged are dropped.
+	void add(const std::vector<Triangle3d>& triangles, float tolerance = FLOATERROR);
+
+	// Normal is computed from the winding of the vertices
+	Triangle3d triangle(size_t face) const;
+	size_t size() const;
+	// True if every edge has a neighbour, so cross sections are closed loops that can be traced through neighbours
+	bool closed() const;
+private:
+	bool isClosed = false;
+
+	void connect();
+};
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include "gcode.h"
+#include "gcodewriter.h"
+#include "Object3D.h"
+#include "pipeline.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+	// Thrown inside a stage to unwind it when another stage has failed
+	struct Aborted {};
+
+	// Layers listed under the arc totals
+	constexpr size_t worstArcLayers = 3;
+}
+
+std::ostream& operator<<(std::ostream& os, const PipelineStats& stats)
+{
+	os << std::fixed << std::setprecision(3);
+	for (const auto& stage : stats.stages) {
+		os << std::left << std::setw(10) << stage.name << std::right
+			<< " busy " << std::setw(8) << stage.busy.count() << " s"
+			<< "  stalled " << std::setw(8) << stage.stalled.count() << " s"
+			<< "  " << stage.items << " items\n";
+	}
+	os << std::left << std::setw(10) << "total" << std::right << " " << stats.total.count() << " s\n";
+	if (!stats.arcs.empty()) {
+		ArcStats all;
+		for (const auto& layer : stats.arcs) {
+			all += layer;
+		}
+		os << std::left << std::setw(10) << "arcs" << std::right << " " << all << "\n";
+		// The layers whose arcs stray furthest from their moves, as the total only keeps the largest deviation
+		std::vector<size_t> fitted;
+		for (size_t i = 0; i < stats.arcs.size(); i++) {
+			if (stats.arcs[i].arcs > 0) {
+				fitted.push_back(i);
+			}
+		}
+		size_t shown = std::min(fitted.size(), worstArcLayers);
+		std::partial_sort(fitted.begin(), fitted.begin() + shown, fitted.end(), [&stats](size_t lhs, size_t rhs) {
+			float left = stats.arcs[lhs].maxDeviation, right = stats.arcs[rhs].maxDeviation;
+			return left > right || (left == right && lhs < rhs);
+		});
+		for (size_t i = 0; i < shown; i++) {
+			size_t push = fitted[i];
+			std::string name = push == 0 ? "start" : push == stats.arcs.size() - 1 ? "end" : "layer " + std::to_string(push);
+			os << "  " << std::left << std::setw(10) << name << std::right << " " << stats.arcs[push] << "\n";
+		}
+	}
+	os << std::defaultfloat;
+	return os;
+}
+
+PipelineStats runPipeline(const std::string& modelFile, bool binary, const std::string& gcodeFile,
+	const Machine& machine, const PrintSettings& settings, size_t queueSize)
+{
+	if (settings.threads == 1) {
+		FileSink sink(gcodeFile);
+		return runPipeline(modelFile, binary, sink, machine, settings, queueSize);
+	}
+	ParallelFileSink sink(gcodeFile, settings.threads);
+	return runPipeline(modelFile, binary, sink, machine, settings, queueSize);
+}
+
+PipelineStats runPipeline(const std::string& modelFile, bool binary, CommandSink& sink,
+	const Machine& machine, const PrintSettings& settings, size_t queueSize)
+{
+	PipelineStats stats;
+	auto start = Clock::now();
+
+	// Slicing needs the whole model, so loading is not overlapped with the other stages
+	Object3D object;
+	object.fromFile(modelFile, binary, settings.threads);
+	stats.stages.push_back({ "load", Clock::now() - start, {}, 1 });
+
+	BoundedQueue<Polygon> layers(queueSize);
+	BoundedQueue<std::vector<Command>> toolpaths(queueSize);
+	StageStats slicing{ "slice" }, planning{ "toolpath" }, writing{ "write" };
+
+	std::exception_ptr error;
+	std::mutex errorMutex;
+	auto fail = [&]() {
+		{
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+		layers.abort();
+		toolpaths.abort();
+	};
+
+	std::thread slicer([&]() {
+		auto begin = Clock::now();
+		try {
+			Plane plane(Vector3d(settings.position), settings.direction, settings.tangent);
+			auto push = [&](Polygon&& layer) {
+				if (!layers.push(std::move(layer))) {
+					throw Aborted{};
+				}
+				slicing.items++;
+			};
+			if (settings.resolution > 0.0f) {
+				FixedPointGrid grid(settings.resolution);
+				object.slice(plane, settings.layerheight, grid, [&](FixedPolygon&& layer) {
+					push(toPolygon(grid, layer));
+				}, settings.threads);
+			}
+			else {
+				object.slice(plane, settings.layerheight, push, settings.threads);
+			}
+		}
+		catch (const Aborted&) {}
+		catch (...) {
+			fail();
+		}
+		layers.close();
+		slicing.stalled = layers.pushWait();
+		slicing.busy = Clock::now() - begin - slicing.stalled;
+	});
+
+	std::thread planner([&]() {
+		auto begin = Clock::now();
+		try {
+			GcodeGenerator generator(machine, settings);
+			auto push = [&](std::vector<Command>&& commands) {
+				if (!toolpaths.push(std::move(commands))) {
+					throw Aborted{};
+				}
+			};
+			push(generator.start());
+			while (auto layer = layers.pop()) {
+				push(generator.layer(*layer));
+				planning.items++;
+			}
+			push(generator.end());
+		}
+		catch (const Aborted&) {}
+		catch (...) {
+			fail();
+		}
+		toolpaths.close();
+		planning.stalled = layers.popWait() + toolpaths.pushWait();
+		planning.busy = Clock::now() - begin - planning.stalled;
+	});
+
+	// Writing runs on this thread, fitting arcs on the way if settings ask for them
+	std::optional<ArcFittingSink> fitting;
+	if (settings.arcDeviation > 0.0f) {
+		fitting.emplace(sink, settings.arcDeviation);
+	}
+	CommandSink& output = fitting ? static_cast<CommandSink&>(*fitting) : sink;
+	auto begin = Clock::now();
+	try {
+		while (auto commands = toolpaths.pop()) {
+			output.push(*commands);
+			writing.items++;
+		}
+		output.finish();
+	}
+	catch (...) {
+		fail();
+	}
+	writing.stalled = toolpaths.popWait();
+	writing.busy = Clock::now() - begin - writing.stalled;
+
+	slicer.join();
+	planner.join();
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	stats.stages.push_back(slicing);
+	stats.stages.push_back(planning);
+	stats.stages.push_back(writing);
+	if (fitting) {
+		stats.arcs = fitting->stats();
+	}
+	stats.total = Clock::now() - start;
+	return stats;
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "arcfitter.h"
+#include "gcode.h"
+#include "printer.h"
+
+template<typename T>
+class BoundedQueue
+{
+	// Hands items from one stage to the next. A full queue blocks the producer so a fast stage cannot run ahead.
+public:
+	using Duration = std::chrono::steady_clock::duration;
+
+	explicit BoundedQueue(size_t capacity) : capacity{ capacity > 0 ? capacity : 1 } {}
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	// Returns false if the queue was aborted, the item is then dropped
+	bool push(T&& item);
+	// Returns nothing once the queue is closed and drained, or aborted
+	std::optional<T> pop();
+	// No more items will be pushed
+	void close();
+	// Drops queued items and wakes both sides, used when a stage fails
+	void abort();
+
+	// Total time spent waiting for room and for items
+	Duration pushWait() const;
+	Duration popWait() const;
+private:
+	std::queue<T> items;
+	size_t capacity;
+	bool closed = false;
+	bool aborted = false;
+	Duration pushWaited{}, popWaited{};
+	mutable std::mutex mutex;
+	std::condition_variable notFull, notEmpty;
+};
+
+struct StageStats {
+	std::string name;
+	std::chrono::duration<double> busy{}; // Time spent working
+	std::chrono::duration<double> stalled{}; // Time spent waiting on the neighbouring stages
+	size_t items = 0;
+};
+
+struct PipelineStats {
+	std::vector<StageStats> stages;
+	std::chrono::duration<double> total{};
+	// Arcs fitted to the start commands, each layer from layer 1 up, then the end commands.
+	// Empty unless settings give an arc deviation.
+	std::vector<ArcStats> arcs;
+};
+
+// Prints the time of each stage, and the arc totals with the layers fitted worst
+std::ostream& operator<<(std::ostream& os, const PipelineStats& stats);
+
+// Loads the model, then slices it, plans toolpaths and pushes them into sink concurrently, one layer at a time.
+// Writing fits arcs to the toolpaths through an ArcFittingSink if settings give an arc deviation.
+// Stages are connected by queues holding at most queueSize layers. Rethrows the first exception thrown by a stage.
+PipelineStats runPipeline(const std::string& modelFile, bool binary, CommandSink& sink,
+	const Machine& machine, const PrintSettings& settings, size_t queueSize = 8);
+// Writes the G-code to gcodeFile, formatting layers in parallel unless settings ask for one thread
+PipelineStats runPipeline(const std::string& modelFile, bool binary, const std::string& gcodeFile,
+	const Machine& machine, const PrintSettings& settings, size_t queueSize = 8);
+
+template<typename T>
+inline bool BoundedQueue<T>::push(T&& item)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (items.size() >= capacity && !aborted) {
+		auto start = std::chrono::steady_clock::now();
+		notFull.wait(lock, [this]() { return items.size() < capacity || aborted; });
+		pushWaited += std::chrono::steady_clock::now() - start;
+	}
+	if (aborted) {
+		return false;
+	}
+	items.push(std::move(item));
+	lock.unlock();
+	notEmpty.notify_one();
+	return true;
+}
+
+template<typename T>
+inline std::optional<T> BoundedQueue<T>::pop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (items.empty() && !closed && !aborted) {
+		auto start = std::chrono::steady_clock::now();
+		notEmpty.wait(lock, [this]() { return !items.empty() || closed || aborted; });
+		popWaited += std::chrono::steady_clock::now() - start;
+	}
+	if (aborted || items.empty()) {
+		return std::nullopt;
+	}
+	std::optional<T> item(std::move(items.front()));
+	items.pop();
+	lock.unlock();
+	notFull.notify_one();
+	return item;
+}
+
+template<typename T>
+inline void BoundedQueue<T>::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+	}
+	notEmpty.notify_all();
+}
+
+template<typename T>
+inline void BoundedQueue<T>::abort()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		aborted = true;
+		items = std::queue<T>();
+	}
+	notFull.notify_all();
+	notEmpty.notify_all();
+}
+
+template<typename T>
+inline typename BoundedQueue<T>::Duration BoundedQueue<T>::pushWait() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pushWaited;
+}
+
+template<typename T>
+inline typename BoundedQueue<T>::Duration BoundedQueue<T>::popWait() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return popWaited;
+}
@@ -38,6 +38,8 @@ void to_json(json& j, const Machine& m) {
 		{"gantryHeight", m.gantryHeight},
 		{"originAtCenter", m.originAtCenter},
 		{"heatedBed", m.heatedBed},
+		{"nozzleDiameter", m.nozzleDiameter},
+		{"filamentDiameter", m.filamentDiameter},
 		{"startGcode", m.startGcode},
 		{"endGcode", m.endGcode},
 	};
@@ -57,6 +59,12 @@ void from_json(const json& j, Machine& m) {
 	j.at("heatedBed").get_to(m.heatedBed);
 	j.at("startGcode").get_to(m.startGcode);
 	j.at("endGcode").get_to(m.endGcode);
+	if (j.contains("nozzleDiameter")) {
+		j.at("nozzleDiameter").get_to(m.nozzleDiameter);
+	}
+	if (j.contains("filamentDiameter")) {
+		j.at("filamentDiameter").get_to(m.filamentDiameter);
+	}
 }
 
 PrintSettings PrintSettings::fromFile(const std::string& filename)
@@ -110,10 +118,15 @@ void to_json(json& j, const PrintSettings& s) {
 		{"layerheight", s.layerheight},
 		{"infill", s.infill},
 		{"scale", s.scale},
+		{"printSpeed", s.printSpeed},
+		{"travelSpeed", s.travelSpeed},
 		{"adhesion", to_string(s.adhesion)},
 		{"position", {s.position[0], s.position[1]}},
 		{"direction", {s.direction[0], s.direction[1], s.direction[2]}},
 		{"tangent", {s.tangent[0], s.tangent[1], s.tangent[2]}},
+		{"threads", s.threads},
+		{"resolution", s.resolution},
+		{"arcDeviation", s.arcDeviation},
 	};
 }
 
@@ -124,4 +137,19 @@ void from_json(const json& j, PrintSettings& s) {
 	std::string adhesionString;
 	j.at("adhesion").get_to(adhesionString);
 	s.adhesion = from_string(adhesionString);
+	if (j.contains("printSpeed")) {
+		j.at("printSpeed").get_to(s.printSpeed);
+	}
+	if (j.contains("travelSpeed")) {
+		j.at("travelSpeed").get_to(s.travelSpeed);
+	}
+	if (j.contains("threads")) {
+		j.at("threads").get_to(s.threads);
+	}
+	if (j.contains("resolution")) {
+		j.at("resolution").get_to(s.resolution);
+	}
+	if (j.contains("arcDeviation")) {
+		j.at("arcDeviation").get_to(s.arcDeviation);
+	}
 }
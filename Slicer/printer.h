@@ -22,6 +22,8 @@ struct Machine
 	float gantryHeight;
 	bool originAtCenter = false;
 	bool heatedBed = false;
+	float nozzleDiameter = 0.4f;
+	float filamentDiameter = 2.85f;
 	std::string startGcode = "", endGcode = "";
 	std::string name;
 };
@@ -40,5 +42,10 @@ struct PrintSettings {
 	float layerheight = 0.1f;
 	float infill = 0.1f;
 	float scale = 1.0f;
+	float printSpeed = 30.0f; // mm/s
+	float travelSpeed = 150.0f; // mm/s
 	Adhesion adhesion = Adhesion::None;
+	unsigned int threads = 0; // Zero uses one thread per hardware thread
+	float resolution = 0.0f; // mm, snaps cross sections onto a grid this fine to join them exactly, zero joins them within FLOATERROR
+	float arcDeviation = 0.0f; // mm, replaces moves with G2 and G3 arcs passing this close to them, zero keeps the moves
 };
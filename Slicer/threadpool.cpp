@@ -0,0 +1,220 @@
+#include <algorithm>
+
+#include "threadpool.h"
+
+namespace {
+	// Pool and queue of the worker running on this thread, if any
+	thread_local const ThreadPool* currentPool = nullptr;
+	thread_local size_t currentQueue = 0;
+}
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (unsigned int i = 0; i <= threads; i++)
+	{
+		queues.push_back(std::make_unique<Queue>());
+	}
+	for (unsigned int i = 0; i < threads; i++)
+	{
+		workers.emplace_back(&ThreadPool::work, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	available.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+unsigned int ThreadPool::size() const
+{
+	return static_cast<unsigned int>(workers.size());
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& body, size_t grain, unsigned int concurrency)
+{
+	if (count == 0) {
+		return;
+	}
+	unsigned int threads = concurrency == 0 ? size() : std::min(concurrency, size());
+	if (grain == 0) {
+		// A few blocks per thread so uneven blocks even out
+		grain = std::max<size_t>(1, count / (static_cast<size_t>(threads) * 4));
+	}
+
+	TaskGroup group(*this);
+	if (threads < size()) {
+		// Only as many tasks as threads, each taking the next block until none are left
+		std::atomic<size_t> next{ 0 };
+		auto take = [&]() {
+			for (size_t begin = next.fetch_add(grain); begin < count; begin = next.fetch_add(grain)) {
+				body(begin, std::min(begin + grain, count));
+			}
+		};
+		for (unsigned int i = 0; i < threads; i++)
+		{
+			group.run(take);
+		}
+		group.wait();
+		return;
+	}
+
+	// Each task halves its range, leaves the upper half to be stolen and keeps going with the lower half
+	std::function<void(size_t, size_t)> split = [&](size_t begin, size_t end) {
+		while (end - begin > grain) {
+			size_t middle = begin + (end - begin) / 2;
+			group.run([&split, middle, end]() { split(middle, end); });
+			end = middle;
+		}
+		body(begin, end);
+	};
+	group.run([&split, count]() { split(0, count); });
+	group.wait();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		// Counted before it is queued so pending never drops below the number of queued tasks
+		std::lock_guard<std::mutex> lock(mutex);
+		pending++;
+	}
+	Queue& queue = *queues[home()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	available.notify_one();
+}
+
+bool ThreadPool::runOne()
+{
+	std::function<void()> task;
+	size_t own = home();
+	{
+		Queue& queue = *queues[own];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+	}
+	for (size_t i = 1; !task && i < queues.size(); i++)
+	{
+		Queue& victim = *queues[(own + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+		}
+	}
+	if (!task) {
+		return false;
+	}
+	pending--;
+	task();
+	return true;
+}
+
+size_t ThreadPool::home() const
+{
+	return currentPool == this ? currentQueue : queues.size() - 1;
+}
+
+void ThreadPool::work(size_t index)
+{
+	currentPool = this;
+	currentQueue = index;
+	while (true) {
+		if (runOne()) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		available.wait(lock, [this]() { return stopping || pending > 0; });
+		if (stopping && pending == 0) {
+			return;
+		}
+	}
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool{ pool }
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+	// Tasks refer to the group, so they must finish before it goes away
+	try {
+		wait();
+	}
+	catch (...) {}
+}
+
+void TaskGroup::run(std::function<void()> task)
+{
+	remaining++;
+	pool.submit([this, task = std::move(task)]() {
+		try {
+			task();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+		// The group may be gone as soon as remaining reaches zero, so only the pool is used after that
+		ThreadPool& pool = this->pool;
+		if (--remaining == 0) {
+			// Taking the lock orders this with a waiter checking remaining before it sleeps
+			{ std::lock_guard<std::mutex> lock(pool.mutex); }
+			pool.available.notify_all();
+		}
+	});
+}
+
+void TaskGroup::wait()
+{
+	while (remaining > 0) {
+		if (pool.runOne()) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(pool.mutex);
+		pool.available.wait(lock, [this]() { return remaining == 0 || pool.pending > 0; });
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (error) {
+		std::exception_ptr thrown = error;
+		error = nullptr;
+		std::rethrow_exception(thrown);
+	}
+}
+
+PoolHandle::PoolHandle(unsigned int threads) : pool{ ThreadPool::shared() }, threads{ threads }
+{
+}
+
+unsigned int PoolHandle::size() const
+{
+	return this->threads == 0 ? this->pool.size() : std::min(this->threads, this->pool.size());
+}
+
+void PoolHandle::parallelFor(size_t count, const std::function<void(size_t, size_t)>& body, size_t grain)
+{
+	this->pool.parallelFor(count, body, grain, this->threads);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+	// Work-stealing pool. Each worker pushes and pops tasks at the back of its own deque and steals
+	// from the front of the others' when it runs dry, so uneven tasks balance out.
+public:
+	// Zero threads uses one thread per hardware thread
+	explicit ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Pool with one thread per hardware thread shared by every stage, so stages running at once do not oversubscribe
+	static ThreadPool& shared();
+
+	unsigned int size() const;
+
+	// Calls body(begin, end) on blocks of [0, count) no larger than grain, zero picks a grain from the pool size.
+	// Blocks are split off lazily so idle workers steal large ranges first.
+	// At most concurrency blocks run at once, zero for as many as there are workers.
+	// Blocks until every block is done, rethrows the first exception thrown by body.
+	void parallelFor(size_t count, const std::function<void(size_t, size_t)>& body, size_t grain = 0, unsigned int concurrency = 0);
+private:
+	friend class TaskGroup;
+
+	struct Queue {
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+	};
+
+	// One queue per worker, and a last one for tasks submitted from outside the pool
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable available; // Signalled when a task is submitted or a task group finishes
+	std::atomic<size_t> pending{ 0 }; // Tasks submitted but not yet taken
+	bool stopping = false;
+
+	void submit(std::function<void()> task);
+	// Runs one task from the queue of the calling thread or stolen from another queue, returns false if there was none
+	bool runOne();
+	size_t home() const;
+	void work(size_t index);
+};
+
+class TaskGroup
+{
+	// Tasks run on a pool that can be waited for together. Waiting runs queued tasks instead of blocking,
+	// so tasks may start and wait for groups of their own.
+public:
+	explicit TaskGroup(ThreadPool& pool);
+	~TaskGroup();
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+	void run(std::function<void()> task);
+	// Blocks until every task is done, rethrows the first exception thrown by a task
+	void wait();
+private:
+	ThreadPool& pool;
+	std::atomic<size_t> remaining{ 0 };
+	std::mutex mutex;
+	std::exception_ptr error;
+};
+
+class PoolHandle
+{
+	// The shared pool, used by at most the given number of threads at once, zero for all of its workers.
+	// Stages asking for their own thread counts share the workers instead of starting threads of their own.
+public:
+	explicit PoolHandle(unsigned int threads);
+	// Number of threads work is spread over
+	unsigned int size() const;
+	void parallelFor(size_t count, const std::function<void(size_t, size_t)>& body, size_t grain = 0);
+private:
+	ThreadPool& pool;
+	unsigned int threads;
+};
@@ -0,0 +1,140 @@
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SLICER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include <cstring>
+
+#include "trianglesoa.h"
+
+TriangleSoA::TriangleSoA(const Mesh& mesh)
+{
+	for (unsigned int slot = 0; slot < 3; slot++)
+	{
+		x[slot].resize(mesh.size());
+		y[slot].resize(mesh.size());
+		z[slot].resize(mesh.size());
+		for (size_t face = 0; face < mesh.size(); face++)
+		{
+			const Vector3d& vertex = mesh.vertices[mesh.faces[face][slot]];
+			x[slot][face] = vertex[0];
+			y[slot][face] = vertex[1];
+			z[slot][face] = vertex[2];
+		}
+	}
+}
+
+size_t TriangleSoA::size() const
+{
+	return x[0].size();
+}
+
+// Distances are computed as plane.normal.dot(vertex - plane.point), in the same order as planeCosine,
+// so every kernel gives the same result as the scalar geometry code.
+// For axis aligned planes the normal is (0, 0, 1), so the distance is just the difference in z.
+
+template<bool AxisAligned>
+void classifyScalar(const TriangleSoA& triangles, const Plane& plane, const std::vector<unsigned int>& faces, size_t begin, PlaneSides& result)
+{
+	for (size_t i = begin; i < faces.size(); i++)
+	{
+		unsigned int face = faces[i];
+		for (unsigned int slot = 0; slot < 3; slot++)
+		{
+			float distance = planeDistance<AxisAligned>(plane, triangles.x[slot][face], triangles.y[slot][face], triangles.z[slot][face]);
+			result.distances[slot][i] = distance;
+			result.sides[slot][i] = distance > FLOATERROR ? 1 : distance < -FLOATERROR ? -1 : 0;
+		}
+	}
+}
+
+#ifdef SLICER_X86
+
+template<bool AxisAligned>
+void classifySSE2(const TriangleSoA& triangles, const Plane& plane, const std::vector<unsigned int>& faces, PlaneSides& result)
+{
+	// SSE2 has no gather, so four faces are loaded one lane at a time
+	const __m128 nx = _mm_set1_ps(plane.normal[0]), ny = _mm_set1_ps(plane.normal[1]), nz = _mm_set1_ps(plane.normal[2]);
+	const __m128 px = _mm_set1_ps(plane.point[0]), py = _mm_set1_ps(plane.point[1]), pz = _mm_set1_ps(plane.point[2]);
+	const __m128 above = _mm_set1_ps(FLOATERROR), below = _mm_set1_ps(-FLOATERROR);
+	const unsigned int* index = faces.data();
+	size_t i = 0;
+	for (; i + 4 <= faces.size(); i += 4)
+	{
+		for (unsigned int slot = 0; slot < 3; slot++)
+		{
+			const float* z = triangles.z[slot].data();
+			__m128 vz = _mm_setr_ps(z[index[i]], z[index[i + 1]], z[index[i + 2]], z[index[i + 3]]);
+			__m128 distance;
+			if constexpr (AxisAligned) {
+				distance = _mm_sub_ps(vz, pz);
+			}
+			else {
+				const float* x = triangles.x[slot].data();
+				const float* y = triangles.y[slot].data();
+				__m128 vx = _mm_setr_ps(x[index[i]], x[index[i + 1]], x[index[i + 2]], x[index[i + 3]]);
+				__m128 vy = _mm_setr_ps(y[index[i]], y[index[i + 1]], y[index[i + 2]], y[index[i + 3]]);
+				distance = _mm_mul_ps(nx, _mm_sub_ps(vx, px));
+				distance = _mm_add_ps(distance, _mm_mul_ps(ny, _mm_sub_ps(vy, py)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(nz, _mm_sub_ps(vz, pz)));
+			}
+			_mm_storeu_ps(result.distances[slot].data() + i, distance);
+
+			// Comparisons give -1 in lanes where true, so below - above is the side
+			__m128i side = _mm_sub_epi32(_mm_castps_si128(_mm_cmplt_ps(distance, below)), _mm_castps_si128(_mm_cmpgt_ps(distance, above)));
+			side = _mm_packs_epi32(side, side);
+			side = _mm_packs_epi16(side, side);
+			int packed = _mm_cvtsi128_si32(side);
+			std::memcpy(result.sides[slot].data() + i, &packed, 4);
+		}
+	}
+	classifyScalar<AxisAligned>(triangles, plane, faces, i, result);
+}
+
+bool supportsSSE2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif
+
+using ClassifyKernel = void (*)(const TriangleSoA&, const Plane&, const std::vector<unsigned int>&, PlaneSides&);
+
+template<bool AxisAligned>
+ClassifyKernel selectKernel()
+{
+#ifdef SLICER_X86
+	if (supportsSSE2()) {
+		return classifySSE2<AxisAligned>;
+	}
+#endif
+	return [](const TriangleSoA& triangles, const Plane& plane, const std::vector<unsigned int>& faces, PlaneSides& result) {
+		classifyScalar<AxisAligned>(triangles, plane, faces, 0, result);
+	};
+}
+
+void classify(const TriangleSoA& triangles, const Plane& plane, const std::vector<unsigned int>& faces, PlaneSides& result)
+{
+	static const ClassifyKernel kernel = selectKernel<false>();
+	static const ClassifyKernel axisAlignedKernel = selectKernel<true>();
+	for (unsigned int slot = 0; slot < 3; slot++)
+	{
+		result.distances[slot].resize(faces.size());
+		result.sides[slot].resize(faces.size());
+	}
+	if (isAxisAligned(plane)) {
+		axisAlignedKernel(triangles, plane, faces, result);
+	}
+	else {
+		kernel(triangles, plane, faces, result);
+	}
+}
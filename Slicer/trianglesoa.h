@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "geometry.h"
+#include "mesh.h"
+
+struct TriangleSoA {
+	// Vertex coordinates of each mesh face, in separate arrays per vertex slot.
+	// x[1][face] is the x coordinate of the second vertex of face.
+	std::vector<float> x[3], y[3], z[3];
+
+	TriangleSoA() = default;
+	explicit TriangleSoA(const Mesh& mesh);
+	size_t size() const;
+};
+
+struct PlaneSides {
+	// Signed distance from plane to each vertex, and which side it is on:
+	// 1 above, -1 below, 0 within FLOATERROR. Indexed by vertex slot, then position in the classified faces.
+	std::pmr::vector<float> distances[3];
+	std::pmr::vector<int8_t> sides[3];
+
+	explicit PlaneSides(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: distances{ std::pmr::vector<float>(resource), std::pmr::vector<float>(resource), std::pmr::vector<float>(resource) },
+		sides{ std::pmr::vector<int8_t>(resource), std::pmr::vector<int8_t>(resource), std::pmr::vector<int8_t>(resource) } {}
+};
+
+// Signed distance from plane to a vertex, as every classify kernel computes it
+template<bool AxisAligned>
+inline float planeDistance(const Plane& plane, float x, float y, float z)
+{
+	if constexpr (AxisAligned) {
+		return z - plane.point[2];
+	}
+	else {
+		float distance = plane.normal[0] * (x - plane.point[0]);
+		distance += plane.normal[1] * (y - plane.point[1]);
+		distance += plane.normal[2] * (z - plane.point[2]);
+		return distance;
+	}
+}
+
+// Classifies the vertices of faces against plane, four faces at a time where the CPU supports it.
+// Axis aligned planes only compare z.
+void classify(const TriangleSoA& triangles, const Plane& plane, const std::vector<unsigned int>& faces, PlaneSides& result);
@@ -1,7 +1,13 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SLICER_SSE
+#include <emmintrin.h>
+#endif
+
 constexpr float FLOATERROR = 1e-5f;
 
 template<typename T, unsigned int N>
@@ -27,10 +33,19 @@ public:
 	Vector<T, N> operator-(const Vector<T, N>& rhs) const;
 	Vector<T, N>& operator*=(T rhs);
 	Vector<T, N> operator*(T rhs) const;
-	friend Vector<T, N> operator*(T lhs, const Vector<T, N>& rhs);
+	friend Vector<T, N> operator*(T lhs, const Vector<T, N>& rhs) {
+		return rhs * lhs;
+	}
 	Vector<T, N>& operator/=(T rhs);
 	Vector<T, N> operator/(T rhs) const;
-	friend Vector<T, N> operator/(T lhs, const Vector<T, N>& rhs);
+	friend Vector<T, N> operator/(T lhs, const Vector<T, N>& rhs) {
+		Vector<T, N> result;
+		for (unsigned int i = 0; i < N; i++)
+		{
+			result.elements[i] = lhs / rhs.elements[i];
+		}
+		return result;
+	}
 
 	T& operator[](unsigned int i);
 	T operator[](unsigned int i) const;
@@ -41,11 +56,13 @@ public:
 	T dot(const Vector<T, N>& rhs) const;
 	bool isClose(const Vector<T, N>& rhs, T tolerance = FLOATERROR) const;
 private:
+	// Packed, so vectors can be copied straight from file data
 	T elements[N]{};
 };
 
 typedef Vector<float, 3> Vector3d;
 typedef Vector<float, 2> Vector2d;
+typedef Vector<int64_t, 2> Vector2i;
 
 Vector3d cross(const Vector3d& lhs, const Vector3d& rhs);
 
@@ -158,7 +175,7 @@ inline Vector<T, N> Vector<T, N>::normalized() const
 template<typename T, unsigned int N>
 inline T Vector<T, N>::length() const
 {
-	return std::sqrtf(this->dot(*this));
+	return std::sqrt(this->dot(*this));
 }
 
 template<typename T, unsigned int N>
@@ -176,7 +193,26 @@ inline T Vector<T, N>::dot(const Vector<T, N>& rhs) const
 template<typename T, unsigned int N>
 inline bool Vector<T, N>::isClose(const Vector<T, N>& rhs, T tolerance) const
 {
-	return (*this - rhs).length() < tolerance;
+	// Compared squared to save the square root
+	Vector<T, N> difference = *this - rhs;
+	return difference.dot(difference) < tolerance * tolerance;
+}
+
+// Exact, for integer vectors, use isClose for float vectors
+template<typename T, unsigned int N>
+inline bool operator==(const Vector<T, N>& lhs, const Vector<T, N>& rhs) {
+	for (unsigned int i = 0; i < N; i++)
+	{
+		if (lhs[i] != rhs[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename T, unsigned int N>
+inline bool operator!=(const Vector<T, N>& lhs, const Vector<T, N>& rhs) {
+	return !(lhs == rhs);
 }
 
 template<typename T, unsigned int N>
@@ -202,14 +238,95 @@ inline std::istream& operator>>(std::istream& in, Vector<T, N>& v) {
 	return in;
 }
 
-template<typename T, unsigned int N>
-inline Vector<T, N> operator*(T lhs, const Vector<T, N>& rhs) {
-	Vector<T, N> result(*this);
-	return result *= rhs;
+#ifdef SLICER_SSE
+// Float vectors of two and three elements work on all elements at once in an SSE register, with the unused lanes zero.
+// Elements stay packed in memory, so loading three takes two loads.
+// Results are the same as the loops above: element wise operations round the same way, and dot adds in the same order.
+
+namespace simd {
+	// The first two floats go through the 64 bit integer load and store, which may alias any type.
+	// _mm_load_sd and _mm_store_sd would access the floats as a double, which breaks strict aliasing.
+	inline __m128 loadPair(const float* elements) {
+		return _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(elements)));
+	}
+
+	inline void storePair(float* elements, __m128 value) {
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(elements), _mm_castps_si128(value));
+	}
+
+	inline __m128 load(const float (&elements)[3]) {
+		return _mm_movelh_ps(loadPair(elements), _mm_load_ss(elements + 2));
+	}
+
+	inline void store(float (&elements)[3], __m128 value) {
+		storePair(elements, value);
+		_mm_store_ss(elements + 2, _mm_movehl_ps(value, value));
+	}
+
+	inline __m128 load(const float (&elements)[2]) {
+		return loadPair(elements);
+	}
+
+	inline void store(float (&elements)[2], __m128 value) {
+		storePair(elements, value);
+	}
+
+	// Sum of the first N lanes, added from the first lane up
+	template<unsigned int N>
+	inline float sum(__m128 value) {
+		__m128 result = _mm_add_ss(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1)));
+		if constexpr (N == 3) {
+			result = _mm_add_ss(result, _mm_movehl_ps(value, value));
+		}
+		return _mm_cvtss_f32(result);
+	}
 }
 
-template<typename T, unsigned int N>
-inline Vector<T, N> operator/(T lhs, const Vector<T, N>& rhs) {
-	Vector<T, N> result(*this);
-	return result /= rhs;
+#define SLICER_SSE_VECTOR(N) \
+template<> \
+inline Vector<float, N>& Vector<float, N>::operator+=(const Vector<float, N>& rhs) \
+{ \
+	simd::store(elements, _mm_add_ps(simd::load(elements), simd::load(rhs.elements))); \
+	return *this; \
+} \
+ \
+template<> \
+inline Vector<float, N> Vector<float, N>::operator-() const \
+{ \
+	Vector<float, N> result; \
+	simd::store(result.elements, _mm_xor_ps(simd::load(elements), _mm_set1_ps(-0.0f))); \
+	return result; \
+} \
+ \
+template<> \
+inline Vector<float, N>& Vector<float, N>::operator-=(const Vector<float, N>& rhs) \
+{ \
+	simd::store(elements, _mm_sub_ps(simd::load(elements), simd::load(rhs.elements))); \
+	return *this; \
+} \
+ \
+template<> \
+inline Vector<float, N>& Vector<float, N>::operator*=(float rhs) \
+{ \
+	simd::store(elements, _mm_mul_ps(simd::load(elements), _mm_set1_ps(rhs))); \
+	return *this; \
+} \
+ \
+template<> \
+inline float Vector<float, N>::dot(const Vector<float, N>& rhs) const \
+{ \
+	return simd::sum<N>(_mm_mul_ps(simd::load(elements), simd::load(rhs.elements))); \
+} \
+ \
+template<> \
+inline bool Vector<float, N>::isClose(const Vector<float, N>& rhs, float tolerance) const \
+{ \
+	__m128 difference = _mm_sub_ps(simd::load(elements), simd::load(rhs.elements)); \
+	return simd::sum<N>(_mm_mul_ps(difference, difference)) < tolerance * tolerance; \
 }
+
+SLICER_SSE_VECTOR(2)
+SLICER_SSE_VECTOR(3)
+
+#undef SLICER_SSE_VECTOR
+#endif
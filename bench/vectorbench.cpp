@@ -0,0 +1,87 @@
+// Times vector expressions from the slicing code, in ns per expression.
+// Builds on its own, as it has a main of its own:
+//   cl /std:c++17 /O2 /EHsc /I..\Slicer vectorbench.cpp ..\Slicer\geometry.cpp ..\Slicer\vector.cpp
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "geometry.h"
+
+namespace {
+	template<typename F>
+	double seconds(F f)
+	{
+		auto start = std::chrono::steady_clock::now();
+		f();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main()
+{
+	// More vectors than fit in L1, so the loops are not just register traffic
+	const size_t count = 1 << 16;
+	const int repeats = 200;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+	std::vector<Vector3d> a(count), b(count), out(count);
+	std::vector<float> t(count);
+	for (size_t i = 0; i < count; i++) {
+		a[i] = Vector3d{ coordinate(random), coordinate(random), coordinate(random) };
+		b[i] = Vector3d{ coordinate(random), coordinate(random), coordinate(random) };
+		t[i] = coordinate(random) / 50.0f;
+	}
+	Plane plane(Vector3d{ 1, 2, 3 }, Vector3d{ 0.1f, 0.2f, 1 }, Vector3d{ 1, 0, 0 });
+	// Keeps the compiler from dropping the loops
+	float sink = 0.0f;
+
+	double lerp = seconds([&] {
+		for (int r = 0; r < repeats; r++) {
+			for (size_t i = 0; i < count; i++) {
+				out[i] = a[i] + (b[i] - a[i]) * t[i];
+			}
+		}
+		});
+	double intersect = seconds([&] {
+		for (int r = 0; r < repeats; r++) {
+			for (size_t i = 0; i < count; i++) {
+				out[i] = intersection(plane, Line(a[i], b[i] - a[i]));
+			}
+		}
+		});
+	double distance = seconds([&] {
+		for (int r = 0; r < repeats; r++) {
+			for (size_t i = 0; i < count; i++) {
+				sink += (plane.point - a[i]).dot(plane.normal);
+			}
+		}
+		});
+	double close = seconds([&] {
+		for (int r = 0; r < repeats; r++) {
+			for (size_t i = 0; i < count; i++) {
+				sink += a[i].isClose(b[i] - a[i] * 0.5f);
+			}
+		}
+		});
+	double subtract = seconds([&] {
+		for (int r = 0; r < repeats; r++) {
+			for (size_t i = 0; i < count; i++) {
+				out[i] = a[i];
+				out[i] -= b[i];
+			}
+		}
+		});
+	for (const auto& v : out) {
+		sink += v[0];
+	}
+
+	double perExpression = 1e9 / (static_cast<double>(count) * repeats);
+	std::printf("lerp           %6.2f ns\n", lerp * perExpression);
+	std::printf("intersection   %6.2f ns\n", intersect * perExpression);
+	std::printf("plane distance %6.2f ns\n", distance * perExpression);
+	std::printf("isClose        %6.2f ns\n", close * perExpression);
+	std::printf("-=             %6.2f ns\n", subtract * perExpression);
+	std::printf("(%g)\n", sink);
+	return 0;
+}